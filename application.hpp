@@ -5,11 +5,25 @@
 #include <chrono>
 #include <algorithm>
 #include <cmath>
-#include "playerCollisionCallback.hpp"
+#include <limits>
+#include "characterController.hpp"
+#include "triggerSystem.hpp"
 #include "socketManager.hpp"
+#include "physicsQueries.hpp"
+#include "inputRecording.hpp"
+#include "physicsProfiler.hpp"
+#include "physicsBroadphase.hpp"
+#include <iomanip>
+#include <memory>
 
 #define DEFAULT_DAMPING_FACTOR 10
 #define DEFAULT_MAX_SPEED 12.0f
+#define JUMP_SPEED 16.7f
+#define WALL_JUMP_SPEED 11.7f
+#define DASH_SPEED 100.0f
+#define FAST_FALL_SPEED 0.1f
+#define FIXED_TIMESTEP (1.0f / 60.0f)
+#define MAX_TICKS_PER_FRAME 5
 
 enum MovementState
 {
@@ -73,20 +87,25 @@ public:
   SocketManager socketManager;
   Camera camera;
   GLFWwindow *window;
-  btDiscreteDynamicsWorld *dynamicsWorld;
+  btDiscreteDynamicsWorld *dynamicsWorld = nullptr;
+  btBroadphaseInterface *broadphase = nullptr;
+  btDefaultCollisionConfiguration *collisionConfiguration = nullptr;
+  btCollisionDispatcher *dispatcher = nullptr;
+  btSequentialImpulseConstraintSolver *solver = nullptr;
 
   std::mutex objectsMutex;
 
   int nextGameObjectId = 0;
 
   int taggedPlayer = -1;
+  TextureHandle fireTexture = INVALID_TEXTURE; // kept cached for the whole run so tagging never waits on an upload
 
   uint32_t WIDTH = 1600;
   uint32_t HEIGHT = 1200;
   bool spacePressed = false;
   bool shiftPressed = false;
-  bool controlPressed = false;
-  bool grounded;
+  bool crouched = false; // stays set while there is no room to stand back up
+  bool grounded = false;
 
   std::chrono::high_resolution_clock::time_point lastTime;
   int frameCount = 0;
@@ -96,12 +115,13 @@ public:
   float lastFrame = 0.0f;
   std::unordered_map<int, GameObject> objects;
 
-  std::chrono::system_clock::time_point currentTime;
   std::chrono::high_resolution_clock::time_point lastBroadcast = std::chrono::high_resolution_clock::now();
 
-  long lastDashTime = 0;
-  long lastSpeedBoostTime = 0;
-  long lastJumpBoostTime = 0;
+  // gameplay timers run on simulation time so a replay sees exactly the same cooldowns
+  double simulationTime = 0.0;
+  double lastDashTime = -INFINITY;
+  double lastSpeedBoostTime = -INFINITY;
+  double lastJumpBoostTime = -INFINITY;
 
   MovementState movementState = MovementState::Air;
   float speedMultiplier = 1;
@@ -109,12 +129,37 @@ public:
 
   float dampingFactor = DEFAULT_DAMPING_FACTOR;
   float maxSpeed = DEFAULT_MAX_SPEED;
-  float wallJumpCount;
-  float dashCount;
+  float wallJumpCount = 2;
+  float dashCount = 1;
+
+  RayBatch rayBatch;
+  int lastWallCheck = -1; // what isTouchingWall returned this tick, -1 when it did not run
+  long long wallSweeps = 0;
+  TriggerSystem triggerSystem;
+  int speedPowerupOverlaps = 0;
+  int jumpPowerupOverlaps = 0;
+
+  // GameObjects keep a reference to their config, so these have to outlive every object
+  PhysicsConfig config0, config1, config2, config3, config4, config5, config6, config7;
+  PhysicsConfig networkedPlayerConfig;
+
+  InputFrame input; // what the player pressed for the tick being simulated
+  float pendingMouseDeltaX = 0.0f;
+  float pendingMouseDeltaY = 0.0f;
+
+  bool headless = false;  // no window, Vulkan or network, used by replay()
+  std::string recordPath; // when set, run() ticks at FIXED_TIMESTEP and records every tick's input
+  InputRecording recording;
+  float tickAccumulator = 0.0f;
+
+  PhysicsProfiler physicsProfiler;
+  PhysicsLodSettings physicsLod;
+  BroadphaseSettings broadphaseSettings;
+  std::vector<glm::vec3> playerPositions;
+  bool printPhysicsStats = false; // print the rolling physics summary next to the FPS counter
 
   Application() : camera(FirstPerson), renderer(camera, WIDTH, HEIGHT), socketManager(this)
   {
-    socketManager.init();
   }
 
   void run()
@@ -122,12 +167,379 @@ public:
     initWindow();
     renderer.initVulkan();
 
-    PhysicsConfig config0;
-    config0.collider = ColliderType::Mesh;
+    // a recorded session has to be reproducible, so it runs without remote players
+    if (recordPath.empty())
+    {
+      socketManager.init();
+    }
+    else
+    {
+      recording.fixedTimestep = FIXED_TIMESTEP;
+    }
+
+    createObjects();
+    renderer.bufferManager.uploadContext.flush(renderer.deviceManager.device);
+    std::cout << "Scene load took " << renderer.bufferManager.uploadContext.submitCount() << " upload submits" << std::endl;
+
+    mainLoop();
+    // socketManager.cleanup();
+  }
+
+  // Loads the scene, then adds remote players, and prints what meshes and textures cost in VRAM and host memory
+  // at both points next to what one copy per object would cost, followed by the allocator's view.
+  void meshReport(int extraPlayers)
+  {
+    initWindow();
+    renderer.initVulkan();
+    createObjects();
+    initPhysicsWorld();
+    renderer.bufferManager.uploadContext.flush(renderer.deviceManager.device);
+    printMeshMemory("scene");
+
+    for (int i = 0; i < extraPlayers; i++)
+    {
+      addPlayer();
+    }
+    renderer.bufferManager.uploadContext.flush(renderer.deviceManager.device);
+    printMeshMemory("scene + " + std::to_string(extraPlayers) + " players");
+
+    cleanupPhysicsWorld();
+    renderer.cleanup();
+  }
+
+  // Adds players round after round while rendering, tags some of them, removes them all again, and fails
+  // unless bindless slots, textures, meshes and GPU memory end every round where the first one ended.
+  void stressPlayers(int players, int rounds)
+  {
+    initWindow();
+    renderer.initVulkan();
+    createObjects();
+    initPhysicsWorld();
+    renderer.bufferManager.uploadContext.flush(renderer.deviceManager.device);
+
+    struct Usage
+    {
+      size_t textureSlots, textureReferences, textureCount, meshReferences, gpuAllocations;
+      VkDeviceSize gpuBytes;
+      bool operator!=(const Usage &other) const
+      {
+        return textureSlots != other.textureSlots || textureReferences != other.textureReferences || textureCount != other.textureCount ||
+               meshReferences != other.meshReferences || gpuAllocations != other.gpuAllocations || gpuBytes != other.gpuBytes;
+      }
+    };
+    auto measure = [this]()
+    {
+      GpuAllocatorStats allocatorStats = renderer.bufferManager.allocator.stats();
+      TextureMemoryStats textureStats = renderer.textureRegistry.stats();
+      return Usage{textureStats.arraySlots, textureStats.references, textureStats.textureCount,
+                   renderer.meshRegistry.stats().references, allocatorStats.allocationCount, allocatorStats.usedBytes};
+    };
+    // enough frames for everything retired by the removals to be destroyed
+    auto renderFrames = [this](int count)
+    {
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int frame = 0; frame < count; frame++)
+      {
+        glfwPollEvents();
+        applyTextureUploads();
+        renderer.drawFrame();
+      }
+      return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / count;
+    };
+
+    renderFrames(renderer.MAX_FRAMES_IN_FLIGHT + 1);
+    // no scene object uses these, so each round's skin is released completely and the next one has to
+    // land in its freed slot instead of growing the array
+    const std::vector<std::string> skins = {"textures/awesomeface.png", "textures/concrete2.png", "textures/sky2.png", "textures/sky3.png"};
+    Usage warm{};
+    for (int round = 0; round < rounds; round++)
+    {
+      auto addStart = std::chrono::high_resolution_clock::now();
+      std::vector<int> ids;
+      for (int i = 0; i < players; i++)
+      {
+        ids.push_back(addPlayer());
+      }
+      double addMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - addStart).count();
+
+      // the tag moves between players like it does over the network
+      for (size_t i = 0; i < ids.size(); i += 10)
+      {
+        setTagged(ids[i]);
+        renderFrames(1);
+      }
+      for (size_t i = 5; i < ids.size(); i += 10)
+      {
+        std::lock_guard<std::mutex> lock(objectsMutex);
+        setTexture(objects.at(ids[i]), skins[round % skins.size()]);
+      }
+      double frameMs = renderFrames(8);
+      size_t peakSlots = renderer.textureRegistry.stats().arraySlots;
+      if (peakSlots + skins.size() > MAX_BINDLESS_TEXTURES)
+      {
+        cleanupPhysicsWorld();
+        renderer.cleanup();
+        throw std::runtime_error("players left no bindless texture slots in round " + std::to_string(round + 1) + "!");
+      }
+
+      auto removeStart = std::chrono::high_resolution_clock::now();
+      for (int id : ids)
+      {
+        removePlayer(id);
+      }
+      double removeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - removeStart).count();
+      renderFrames(renderer.MAX_FRAMES_IN_FLIGHT + 1);
+
+      Usage usage = measure();
+      std::cout << "round " << round + 1 << ": " << objects.size() + players << " objects, add " << addMs << " ms, frame " << frameMs << " ms, remove " << removeMs << " ms, "
+                << peakSlots << " of " << MAX_BINDLESS_TEXTURES << " texture slots, " << usage.textureCount << " textures, " << usage.gpuAllocations
+                << " GPU allocations" << std::endl;
+
+      // the first round leaves the instance buffers grown to fit, every later one has to match it
+      if (round == 0)
+      {
+        warm = usage;
+      }
+      else if (usage != warm)
+      {
+        cleanupPhysicsWorld();
+        renderer.cleanup();
+        throw std::runtime_error("players leaked resources in round " + std::to_string(round + 1) + "!");
+      }
+    }
+    std::cout << "No leaks after " << rounds << " rounds of " << players << " players" << std::endl;
+
+    cleanupPhysicsWorld();
+    renderer.cleanup();
+  }
+
+  // Fills the view with cubes up to each count and prints the CPU time spent culling and recording a
+  // frame on one thread and on every core. Objects are packed in front of the camera so all of them
+  // stay visible, alternating textures so the bindless lookups vary within a draw.
+  void benchRender(const std::vector<int> &counts)
+  {
+    initWindow();
+    renderer.initVulkan();
+    createObjects();
+    renderer.bufferManager.uploadContext.flush(renderer.deviceManager.device);
+
+    const int columns = 50;
+    const float spacing = 0.5f;
+    int added = 0;
+    for (int count : counts)
+    {
+      for (; added < count; added++)
+      {
+        int column = added % columns;
+        int row = (added / columns) % columns;
+        int layer = added / (columns * columns);
+        glm::vec3 pos = camera.Position + camera.Front * (40.0f + layer * spacing) + camera.Right * ((column - columns / 2) * spacing) + camera.Up * ((row - columns / 2) * spacing);
+
+        objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, networkedPlayerConfig, pos, glm::vec3(0.2f), glm::vec3(0, 0, 0), cubeVertices, cubeIndices));
+        addGraphics(nextGameObjectId, added % 2 == 0 ? "textures/wall.png" : "textures/fire.png");
+        nextGameObjectId++;
+      }
+      renderer.bufferManager.uploadContext.flush(renderer.deviceManager.device);
+
+      std::cout << count << " objects:" << std::endl;
+      double singleThreadMs = 0.0;
+      for (size_t threads : {static_cast<size_t>(1), renderer.recordWorkers.threadCount()})
+      {
+        renderer.recordThreads = threads;
+        const int warmupFrames = 10;
+        const int frames = 60;
+        double cullMs = 0.0;
+        double recordMs = 0.0;
+        for (int frame = 0; frame < warmupFrames + frames; frame++)
+        {
+          glfwPollEvents();
+          renderer.drawFrame();
+          if (frame >= warmupFrames)
+          {
+            cullMs += renderer.cullingStats.cullMs;
+            recordMs += renderer.cullingStats.recordMs;
+          }
+        }
+        cullMs /= frames;
+        recordMs /= frames;
+        if (threads == 1)
+        {
+          singleThreadMs = recordMs;
+        }
+
+        std::cout << "  " << renderer.cullingStats.recordSlices << " of " << threads << " threads: " << renderer.cullingStats.visible << " visible, " << renderer.cullingStats.drawCalls << " draws, cull "
+                  << cullMs << " ms, record " << recordMs << " ms (" << singleThreadMs / recordMs << "x)" << std::endl;
+      }
+    }
+    renderer.recordThreads = 0;
+
+    renderer.cleanup();
+  }
+
+  void printMeshMemory(const std::string &label)
+  {
+    MeshMemoryStats stats = renderer.meshRegistry.stats();
+    size_t hostBytes = 0;
+    size_t unsharedHostBytes = 0;
+    for (const auto &gameObject : objects)
+    {
+      hostBytes += gameObject.second.vertices.capacity() * sizeof(Vertex) + gameObject.second.indices.capacity() * sizeof(uint32_t);
+      if (gameObject.second.mesh != INVALID_MESH)
+      {
+        const GpuMesh &mesh = renderer.meshRegistry.get(gameObject.second.mesh);
+        unsharedHostBytes += mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * sizeof(uint32_t);
+      }
+    }
+
+    std::cout << label << ": " << stats.meshCount << " meshes for " << stats.references << " objects" << std::endl;
+    std::cout << "  VRAM " << stats.gpuBytes / 1024.0 << " KiB, one copy per object would be " << stats.unsharedGpuBytes / 1024.0 << " KiB" << std::endl;
+    std::cout << "  host " << hostBytes / 1024.0 << " KiB, keeping every copy would be " << unsharedHostBytes / 1024.0 << " KiB" << std::endl;
+
+    TextureMemoryStats textureStats = renderer.textureRegistry.stats();
+    std::cout << "  " << textureStats.textureCount << " textures (" << textureStats.compressedCount << " block compressed) for " << textureStats.references << " references, VRAM " << textureStats.gpuBytes / 1024.0
+              << " KiB, one copy per reference would be " << textureStats.unsharedGpuBytes / 1024.0 << " KiB" << std::endl;
+    renderer.bufferManager.allocator.printStats(std::cout);
+  }
+
+  // Replays a recording without a window and prints the final transforms and tick times, so physics
+  // and gameplay cost can be compared across commits on identical input.
+  void replay(const std::string &path)
+  {
+    if (!recording.load(path))
+    {
+      throw std::runtime_error("failed to load input recording: " + path);
+    }
+
+    headless = true;
+    createObjects();
+    initPhysicsWorld();
+
+    std::vector<float> tickTimes;
+    tickTimes.reserve(recording.frames.size());
+    for (const InputFrame &frame : recording.frames)
+    {
+      input = frame;
+
+      auto start = std::chrono::high_resolution_clock::now();
+      simulate(recording.fixedTimestep);
+      std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+      tickTimes.push_back(elapsed.count());
+    }
+
+    printTransforms();
+
+    if (!tickTimes.empty())
+    {
+      float total = 0;
+      for (float tickTime : tickTimes)
+      {
+        total += tickTime;
+      }
+      std::sort(tickTimes.begin(), tickTimes.end());
+
+      std::cout << "Replayed " << tickTimes.size() << " ticks" << std::endl;
+      std::cout << "mean: " << total / tickTimes.size() << " ms" << std::endl;
+      std::cout << "median: " << tickTimes[tickTimes.size() / 2] << " ms" << std::endl;
+      std::cout << "p99: " << tickTimes[tickTimes.size() * 99 / 100] << " ms" << std::endl;
+      std::cout << "max: " << tickTimes.back() << " ms" << std::endl;
+    }
+
+    physicsProfiler.printSummary(std::cout);
+
+    cleanupPhysicsWorld();
+  }
+
+  // What the character queries decided on one replayed tick
+  struct RayCheckTick
+  {
+    bool grounded;
+    int wallCheck;
+    glm::vec3 playerPos;
+  };
+
+  std::vector<RayCheckTick> replayRayChecks(const std::string &path)
+  {
+    if (!recording.load(path))
+    {
+      throw std::runtime_error("failed to load input recording: " + path);
+    }
+
+    headless = true;
+    createObjects();
+    initPhysicsWorld();
+
+    std::vector<RayCheckTick> ticks;
+    ticks.reserve(recording.frames.size());
+    for (const InputFrame &frame : recording.frames)
+    {
+      input = frame;
+      lastWallCheck = -1;
+      simulate(recording.fixedTimestep);
+      ticks.push_back({grounded, lastWallCheck, objects.at(6).pos});
+    }
+
+    cleanupPhysicsWorld();
+    return ticks;
+  }
+
+  // Replays a recording once with every ray cast on its own, the way the checks worked before RayBatch,
+  // and once batched. Prints the first tick where grounded, the wall check or the player position differ
+  // and the character queries per tick of both.
+  static bool checkRayBatch(const std::string &path)
+  {
+    std::unique_ptr<Application> separate = std::make_unique<Application>();
+    separate->rayBatch.castSeparately = true;
+    std::vector<RayCheckTick> expected = separate->replayRayChecks(path);
+
+    std::unique_ptr<Application> batched = std::make_unique<Application>();
+    std::vector<RayCheckTick> actual = batched->replayRayChecks(path);
+
+    size_t mismatch = expected.size();
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+      if (expected[i].grounded != actual[i].grounded || expected[i].wallCheck != actual[i].wallCheck || expected[i].playerPos != actual[i].playerPos)
+      {
+        mismatch = i;
+        break;
+      }
+    }
+
+    double ticks = std::max(expected.size(), static_cast<size_t>(1));
+    for (Application *app : {separate.get(), batched.get()})
+    {
+      const RayBatchStats &stats = app->rayBatch.stats;
+      std::cout << (app == separate.get() ? "separate: " : "batched:  ") << stats.rays / ticks << " rays, " << stats.traversals / ticks << " broadphase traversals, "
+                << stats.narrowphaseTests / ticks << " narrowphase tests, " << app->wallSweeps / ticks << " wall sweeps per tick" << std::endl;
+    }
+
+    if (mismatch < expected.size())
+    {
+      const RayCheckTick &a = expected[mismatch];
+      const RayCheckTick &b = actual[mismatch];
+      std::cout << std::setprecision(9) << "tick " << mismatch << " differs: grounded " << a.grounded << "/" << b.grounded << ", wall " << a.wallCheck << "/" << b.wallCheck
+                << ", player " << a.playerPos.x << " " << a.playerPos.y << " " << a.playerPos.z << " / " << b.playerPos.x << " " << b.playerPos.y << " " << b.playerPos.z << std::endl;
+      return false;
+    }
+
+    std::cout << expected.size() << " ticks identical" << std::endl;
+    return true;
+  }
+
+  void createObjects()
+  {
+    networkedPlayerConfig.collider = ColliderType::Box;
+    networkedPlayerConfig.isRigidBody = true;
+    networkedPlayerConfig.isKinematic = true;
+    networkedPlayerConfig.canRotateX = false;
+    networkedPlayerConfig.canRotateY = false;
+    networkedPlayerConfig.canRotateZ = false;
+    networkedPlayerConfig.friction = 0.8;
+    networkedPlayerConfig.restitution = 0.8;
+
+    config0.collider = ColliderType::ConvexDecomposition;
     config0.isRigidBody = true;
     config0.mass = 74;
 
-    PhysicsConfig config1;
     config1.collider = ColliderType::Box;
     config1.isRigidBody = true;
     config1.canMove = false;
@@ -138,38 +550,31 @@ public:
     config1.mass = 0;
     config1.restitution = 0.1;
 
-    PhysicsConfig config2;
     config2.collider = ColliderType::Box;
     config2.isRigidBody = true;
     config2.mass = 1;
 
-    PhysicsConfig config3;
     config3.collider = ColliderType::Box;
     config3.isRigidBody = true;
     config3.mass = 1;
 
-    PhysicsConfig config4;
     config4.collider = ColliderType::Box;
+    config4.isRigidBody = false;
+    config4.isTrigger = true;
     config4.canMove = false;
     config4.interactable = false;
     config4.mass = 1;
+    config4.boxColliderSize = glm::vec3(1.5, 1.5, 1.5);
 
-    PhysicsConfig config5;
     config5.collider = ColliderType::None;
     config5.mass = 0;
 
-    PhysicsConfig config6;
     config6.collider = ColliderType::Box;
-    config6.isRigidBody = true;
+    config6.isCharacter = true;
     config6.canRotateX = false;
     config6.canRotateY = false;
     config6.canRotateZ = false;
-    config6.friction = 0.8;
-    config6.linearDamping = 0.1;
-    config6.mass = 30;
-    config6.restitution = 0.8;
 
-    PhysicsConfig config7;
     config7.collider = ColliderType::Mesh;
     config7.isRigidBody = true;
     config7.canMove = false;
@@ -183,54 +588,57 @@ public:
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config0, glm::vec3(0, 5, 0), glm::vec3(0.1, 0.1, 0.1), glm::vec3(10, 40, 50), {}, {}));
     objects.at(nextGameObjectId).loadModel("models/couch/couch1.obj");
-    objects.at(nextGameObjectId).initGraphics(renderer, "models/couch/gray.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "models/couch/gray.png");
     nextGameObjectId++;
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config1, glm::vec3(0, 0, 0), glm::vec3(50, 2, 50), glm::vec3(0, 0, 0), cubeVertices, cubeIndices, GameObjectTags::Ground));
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/wood.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "textures/wood.png");
     nextGameObjectId++;
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config2, glm::vec3(0, 30, 0), glm::vec3(1, 1, 1), glm::vec3(0, 30, 45), cubeVertices, cubeIndices));
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/metal.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "textures/metal.png");
     nextGameObjectId++;
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config3, glm::vec3(5.1, 15, 0), glm::vec3(2, 1, 1), glm::vec3(0, 10, 45), cubeVertices, cubeIndices));
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/wall.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "textures/wall.png");
     nextGameObjectId++;
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config4, glm::vec3(5, 5, 0), glm::vec3(1, 1, 1), glm::vec3(0, 0, 0), cubeVertices, cubeIndices, GameObjectTags::SpeedPowerup));
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/wood.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "textures/wood.png");
     nextGameObjectId++;
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config5, glm::vec3(0, 0, 0), glm::vec3(500, 500, 500), glm::vec3(0, 0, 0), cubeVertices, skyBoxIndices));
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/sky.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "textures/sky.png");
     nextGameObjectId++;
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config6, glm::vec3(-5, 5, 0), glm::vec3(1, 3, 1), glm::vec3(0, 0, 0), cubeVertices, cubeIndices, GameObjectTags::Player));
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/wall.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "textures/wall.png");
     nextGameObjectId++;
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config7, glm::vec3(0, -50, 0), glm::vec3(50, 50, 50), glm::vec3(0, 0, 0), {}, {}, GameObjectTags::Ground));
     objects.at(nextGameObjectId).loadModel("models/testMap/testMap.obj");
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/concrete.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "textures/concrete.png");
     nextGameObjectId++;
 
     objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config4, glm::vec3(15, -20, 16), glm::vec3(1, 1, 1), glm::vec3(0, 0, 0), cubeVertices, cubeIndices, GameObjectTags::JumpPowerup));
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/wood.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    addGraphics(nextGameObjectId, "textures/wood.png");
     nextGameObjectId++;
 
-    mainLoop();
-    renderer.cleanup();
-    // socketManager.cleanup();
+    if (!headless)
+    {
+      fireTexture = renderer.textureRegistry.acquire("textures/fire.png", renderer.deviceManager.device);
+    }
+  }
+
+  void addGraphics(int id, const std::string &texturePath)
+  {
+    if (headless)
+    {
+      return;
+    }
+
+    objects.at(id).initGraphics(renderer, texturePath);
+    renderer.drawObjects.emplace(id, &objects.at(id));
   }
 
   void initWindow()
@@ -269,7 +677,9 @@ public:
     app->lastX = xpos;
     app->lastY = ypos;
 
-    app->camera.ProcessMouseMovement(xoffset, yoffset);
+    // applied by the next simulate() so that mouse look is part of the recorded input
+    app->pendingMouseDeltaX += xoffset;
+    app->pendingMouseDeltaY += yoffset;
   }
 
   static void framebufferResizeCallback(GLFWwindow *window, int width, int height)
@@ -283,25 +693,76 @@ public:
     app->camera.ProcessMouseScroll(static_cast<float>(yoffset));
   }
 
-  void mainLoop()
+  void initPhysicsWorld()
   {
-    initFPSCounter();
-    btBroadphaseInterface *broadphase = new btDbvtBroadphase();
-    btDefaultCollisionConfiguration *collisionConfiguration = new btDefaultCollisionConfiguration();
-    btCollisionDispatcher *dispatcher = new btCollisionDispatcher(collisionConfiguration);
-    btSequentialImpulseConstraintSolver *solver = new btSequentialImpulseConstraintSolver();
+    btVector3 worldMin, worldMax;
+    computeStaticWorldBounds(worldMin, worldMax);
+    broadphase = createBroadphase(broadphaseSettings, worldMin, worldMax);
+    collisionConfiguration = new btDefaultCollisionConfiguration();
+    dispatcher = new btCollisionDispatcher(collisionConfiguration);
+    solver = new btSequentialImpulseConstraintSolver();
     dynamicsWorld = new btDiscreteDynamicsWorld(dispatcher, broadphase, solver, collisionConfiguration);
     dynamicsWorld->setGravity(btVector3(0, -20.f, 0));
+    broadphase->getOverlappingPairCache()->setInternalGhostPairCallback(&triggerSystem);
 
     for (auto &gameObject : objects)
     {
       gameObject.second.initPhysics(dynamicsWorld);
     }
-    objects.at(6).rigidBody->setCcdMotionThreshold(0.5f);
-    objects.at(6).rigidBody->setCcdSweptSphereRadius(0.5f);
-    PlayerContactCallback callback(objects.at(6).rigidBody);
+  }
+
+  // Bounds of everything in the static world group, used to size an AxisSweep broadphase
+  void computeStaticWorldBounds(btVector3 &worldMin, btVector3 &worldMax)
+  {
+    glm::vec3 minCorner(std::numeric_limits<float>::max());
+    glm::vec3 maxCorner(std::numeric_limits<float>::lowest());
+
+    for (const auto &gameObject : objects)
+    {
+      glm::vec3 objectMin, objectMax;
+      if (gameObject.second.config.collider == ColliderType::None || gameObject.second.getCollisionGroup() != StaticWorldGroup || !gameObject.second.getWorldBounds(objectMin, objectMax))
+      {
+        continue;
+      }
+
+      minCorner = glm::min(minCorner, objectMin);
+      maxCorner = glm::max(maxCorner, objectMax);
+    }
+
+    if (minCorner.x > maxCorner.x)
+    {
+      minCorner = glm::vec3(-1000);
+      maxCorner = glm::vec3(1000);
+    }
+
+    worldMin = btVector3(minCorner.x, minCorner.y, minCorner.z);
+    worldMax = btVector3(maxCorner.x, maxCorner.y, maxCorner.z);
+  }
+
+  void cleanupPhysicsWorld()
+  {
+    for (auto &gameObject : objects)
+    {
+      gameObject.second.cleanupPhysics(dynamicsWorld);
+    }
+
+    delete dynamicsWorld;
+    delete solver;
+    delete dispatcher;
+    delete collisionConfiguration;
+    delete broadphase;
+    dynamicsWorld = nullptr;
+  }
 
-    socketManager.startReceiving();
+  void mainLoop()
+  {
+    initFPSCounter();
+    initPhysicsWorld();
+
+    if (recordPath.empty())
+    {
+      socketManager.startReceiving();
+    }
 
     while (!glfwWindowShouldClose(renderer.window))
     {
@@ -312,143 +773,236 @@ public:
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        float time = glfwGetTime();
-
-        dynamicsWorld->stepSimulation(deltaTime);
-        dynamicsWorld->contactTest(objects.at(6).rigidBody, callback);
+        if (glfwGetKey(renderer.window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+          glfwSetWindowShouldClose(renderer.window, true);
 
-        grounded = isPlayerGrounded(objects.at(6), dynamicsWorld);
-
-        currentTime = std::chrono::system_clock::now();
-        std::chrono::seconds duration = std::chrono::duration_cast<std::chrono::seconds>(currentTime.time_since_epoch());
-        long currentTimeInSeconds = duration.count();
-        if (grounded)
+        if (recordPath.empty())
         {
-          movementState = MovementState::Ground;
-          wallJumpCount = 2;
-
-          if (currentTimeInSeconds - lastDashTime >= 1)
-          {
-            dashCount = 1;
-          }
+          input = sampleInput();
+          simulate(deltaTime);
         }
         else
         {
-          movementState = MovementState::Air;
+          // fixed ticks, keys held for the whole frame and the mouse movement goes to the first tick
+          tickAccumulator += deltaTime;
+          int ticks = 0;
+          while (tickAccumulator >= FIXED_TIMESTEP && ticks < MAX_TICKS_PER_FRAME)
+          {
+            input = sampleInput();
+            recording.frames.push_back(input);
+            simulate(FIXED_TIMESTEP);
+            tickAccumulator -= FIXED_TIMESTEP;
+            ticks++;
+          }
+          if (ticks == MAX_TICKS_PER_FRAME)
+          {
+            tickAccumulator = 0.0f;
+          }
         }
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> elapsed = currentTime - lastBroadcast;
-        if (elapsed.count() >= 0.1f)
+        if (recordPath.empty())
         {
-          socketManager.broadcast(objects.at(6).pos);
-          lastBroadcast = currentTime;
+          auto currentTime = std::chrono::high_resolution_clock::now();
+          std::chrono::duration<float> elapsed = currentTime - lastBroadcast;
+          if (elapsed.count() >= 0.1f)
+          {
+            socketManager.broadcast(objects.at(6).pos);
+            lastBroadcast = currentTime;
+          }
         }
 
-        if (currentTimeInSeconds - lastSpeedBoostTime < 5)
-        {
-          speedMultiplier = 1.5;
-        }
-        else
-        {
-          speedMultiplier = 1;
-        }
+        glfwPollEvents();
 
-        if (currentTimeInSeconds - lastJumpBoostTime < 5)
-        {
-          jumpMultiplier = 1.5;
-        }
-        else
-        {
-          jumpMultiplier = 1;
-        }
+        applyTextureUploads();
+        renderer.drawFrame();
 
-        for (auto &gameObject : objects)
-        {
-          if (gameObject.second.tag == GameObjectTags::SpeedPowerup && glm::distance(objects.at(6).pos, gameObject.second.pos) < 2)
-          {
-            lastSpeedBoostTime = currentTimeInSeconds;
-          }
-          else if (gameObject.second.tag == GameObjectTags::JumpPowerup && glm::distance(objects.at(6).pos, gameObject.second.pos) < 2)
-          {
-            lastJumpBoostTime = currentTimeInSeconds;
-          }
+        updateFPSCounter();
+      }
+    }
 
-          gameObject.second.updatePhysics();
-        }
+    if (!recordPath.empty())
+    {
+      recording.save(recordPath);
+      std::cout << "Recorded " << recording.frames.size() << " ticks to " << recordPath << std::endl;
+      printTransforms();
+    }
 
-        if (camera.type = FirstPerson)
-        {
-          processPlayerInput(objects.at(6));
-          btTransform trans;
-          objects.at(6).rigidBody->getMotionState()->getWorldTransform(trans);
-          btVector3 origin = trans.getOrigin();
-          camera.Position = glm::vec3(origin.x(), origin.y() + objects.at(6).scale.y * 0.4, origin.z());
+    cleanupPhysicsWorld();
+    renderer.cleanup();
+    if (recordPath.empty())
+    {
+      socketManager.cleanup();
+    }
+  }
 
-          btVector3 velocity = objects.at(6).rigidBody->getLinearVelocity();
+  // Advances gameplay and physics by one step using only `input`, so a recorded session replays exactly.
+  void simulate(float stepTime)
+  {
+    simulationTime += stepTime;
 
-          btVector3 horizontalVelocity(velocity.x(), 0.0f, velocity.z());
+    camera.ProcessMouseMovement(input.mouseDeltaX, input.mouseDeltaY);
 
-          float speed = horizontalVelocity.length();
+    playerPositions.clear();
+    for (auto &gameObject : objects)
+    {
+      gameObject.second.updateKinematic(stepTime);
 
-          float zoomFactor = 1.0f + speed / (maxSpeed * 4);
-          float smoothSpeed = 10.0f;
-          camera.Zoom = zoomLerp(camera.Zoom, std::clamp(ZOOM * zoomFactor, 85.0f, 120.0f), smoothSpeed * deltaTime);
+      if (gameObject.second.tag == GameObjectTags::Player || gameObject.second.tag == GameObjectTags::NetworkedPlayer)
+      {
+        playerPositions.push_back(gameObject.second.physicsPos);
+      }
+    }
 
-          if (speed > maxSpeed * speedMultiplier)
-          {
-            btVector3 excessVelocity = horizontalVelocity.normalized() * (speed - maxSpeed * speedMultiplier);
+    for (auto &gameObject : objects)
+    {
+      applyPhysicsLod(gameObject.second, playerPositions, physicsLod);
+    }
 
-            btVector3 dampingForce = -excessVelocity * objects.at(6).rigidBody->getMass() * dampingFactor;
+    auto stepStart = std::chrono::high_resolution_clock::now();
+    dynamicsWorld->stepSimulation(stepTime);
+    std::chrono::duration<float, std::milli> stepElapsed = std::chrono::high_resolution_clock::now() - stepStart;
 
-            objects.at(6).rigidBody->applyCentralForce(dampingForce);
-            objects.at(6).rigidBody->activate();
-          }
-        }
-        else
-        {
-          processInput();
-        }
+    objects.at(6).characterController->update(stepTime);
 
-        glfwPollEvents();
+    grounded = isPlayerGrounded(objects.at(6), dynamicsWorld);
 
-        renderer.drawFrame();
+    if (grounded)
+    {
+      movementState = MovementState::Ground;
+      wallJumpCount = 2;
 
-        updateFPSCounter();
+      if (simulationTime - lastDashTime >= 1)
+      {
+        dashCount = 1;
       }
     }
+    else
+    {
+      movementState = MovementState::Air;
+    }
 
-    delete dynamicsWorld;
-    delete solver;
-    delete dispatcher;
-    delete collisionConfiguration;
-    delete broadphase;
-    vkDeviceWaitIdle(renderer.deviceManager.device);
+    processTriggerEvents();
+
+    if (speedPowerupOverlaps > 0 || simulationTime - lastSpeedBoostTime < 5)
+    {
+      speedMultiplier = 1.5;
+    }
+    else
+    {
+      speedMultiplier = 1;
+    }
+
+    if (jumpPowerupOverlaps > 0 || simulationTime - lastJumpBoostTime < 5)
+    {
+      jumpMultiplier = 1.5;
+    }
+    else
+    {
+      jumpMultiplier = 1;
+    }
 
-    renderer.swapchainManager.cleanupDepthImages(renderer.deviceManager.device);
-    renderer.swapchainManager.cleanupSwapChain(renderer.deviceManager.device);
+    for (auto &gameObject : objects)
+    {
+      gameObject.second.updatePhysics();
+    }
+
+    if (camera.type = FirstPerson)
+    {
+      processPlayerInput(objects.at(6));
+      btVector3 origin = objects.at(6).characterController->position;
+      camera.Position = glm::vec3(origin.x(), origin.y() + objects.at(6).scale.y * 0.4, origin.z());
+
+      btVector3 velocity = objects.at(6).characterController->velocity;
 
-    renderer.bufferManager.cleanup(renderer.deviceManager.device);
+      btVector3 horizontalVelocity(velocity.x(), 0.0f, velocity.z());
 
-    renderer.descriptorManager.cleanup(renderer.deviceManager.device);
+      float speed = horizontalVelocity.length();
 
-    renderer.pipelineManager.cleanup(renderer.deviceManager.device);
+      float zoomFactor = 1.0f + speed / (maxSpeed * 4);
+      float smoothSpeed = 10.0f;
+      camera.Zoom = zoomLerp(camera.Zoom, std::clamp(ZOOM * zoomFactor, 85.0f, 120.0f), smoothSpeed * stepTime);
 
-    for (size_t i = 0; i < renderer.MAX_FRAMES_IN_FLIGHT; i++)
+      objects.at(6).characterController->maxSpeed = maxSpeed * speedMultiplier;
+      objects.at(6).characterController->overspeedDamping = dampingFactor;
+    }
+    else
     {
-      vkDestroySemaphore(renderer.deviceManager.device, renderer.renderFinishedSemaphores[i], nullptr);
-      vkDestroySemaphore(renderer.deviceManager.device, renderer.imageAvailableSemaphores[i], nullptr);
-      vkDestroyFence(renderer.deviceManager.device, renderer.inFlightFences[i], nullptr);
+      processInput();
     }
 
-    vkDestroyCommandPool(renderer.deviceManager.device, renderer.commandPool, nullptr);
-    for (auto &gameObject : objects)
+    physicsProfiler.endStep(dynamicsWorld, stepElapsed.count());
+  }
+
+  InputFrame sampleInput()
+  {
+    const std::pair<int, uint32_t> keyBindings[] = {
+        {GLFW_KEY_W, INPUT_KEY_W},
+        {GLFW_KEY_A, INPUT_KEY_A},
+        {GLFW_KEY_S, INPUT_KEY_S},
+        {GLFW_KEY_D, INPUT_KEY_D},
+        {GLFW_KEY_SPACE, INPUT_KEY_SPACE},
+        {GLFW_KEY_LEFT_SHIFT, INPUT_KEY_LEFT_SHIFT},
+        {GLFW_KEY_LEFT_CONTROL, INPUT_KEY_LEFT_CONTROL}};
+
+    InputFrame frame;
+    for (const auto &binding : keyBindings)
     {
-      gameObject.second.cleanupPhysics(dynamicsWorld);
-      gameObject.second.textureManager.cleanup(renderer.deviceManager.device);
+      if (glfwGetKey(renderer.window, binding.first) == GLFW_PRESS)
+      {
+        frame.keys |= binding.second;
+      }
     }
-    renderer.cleanup();
-    socketManager.cleanup();
+
+    frame.mouseDeltaX = pendingMouseDeltaX;
+    frame.mouseDeltaY = pendingMouseDeltaY;
+    pendingMouseDeltaX = 0.0f;
+    pendingMouseDeltaY = 0.0f;
+
+    return frame;
+  }
+
+  void printTransforms()
+  {
+    std::vector<int> ids;
+    for (const auto &gameObject : objects)
+    {
+      ids.push_back(gameObject.first);
+    }
+    std::sort(ids.begin(), ids.end());
+
+    std::cout << std::setprecision(9);
+    for (int id : ids)
+    {
+      const GameObject &gameObject = objects.at(id);
+      std::cout << id << ": pos " << gameObject.pos.x << " " << gameObject.pos.y << " " << gameObject.pos.z
+                << " rot " << gameObject.rotationZYX.x << " " << gameObject.rotationZYX.y << " " << gameObject.rotationZYX.z << std::endl;
+    }
+    std::cout << std::setprecision(6);
+  }
+
+  void processTriggerEvents()
+  {
+    for (const TriggerEvent &event : triggerSystem.events)
+    {
+      auto trigger = objects.find(event.triggerIndex);
+      if (event.otherIndex != 6 || trigger == objects.end())
+      {
+        continue;
+      }
+
+      // boosts hold while the player stays inside and run for 5 more seconds after leaving
+      if (trigger->second.tag == GameObjectTags::SpeedPowerup)
+      {
+        speedPowerupOverlaps += event.entered ? 1 : -1;
+        lastSpeedBoostTime = simulationTime;
+      }
+      else if (trigger->second.tag == GameObjectTags::JumpPowerup)
+      {
+        jumpPowerupOverlaps += event.entered ? 1 : -1;
+        lastJumpBoostTime = simulationTime;
+      }
+    }
+    triggerSystem.events.clear();
   }
 
   float zoomLerp(float start, float end, float t)
@@ -460,20 +1014,8 @@ public:
   {
     std::lock_guard<std::mutex> lock(objectsMutex);
 
-    PhysicsConfig config;
-    config.collider = ColliderType::Box;
-    config.isRigidBody = true;
-    config.canMove = false;
-    config.canRotateX = false;
-    config.canRotateY = false;
-    config.canRotateZ = false;
-    config.friction = 0.8;
-    config.linearDamping = 0.1;
-    config.mass = 30;
-    config.restitution = 0.8;
-    objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, config, glm::vec3(-5, 5, 0), glm::vec3(1, 3, 1), glm::vec3(0, 0, 0), cubeVertices, cubeIndices, GameObjectTags::NetworkedPlayer));
-    objects.at(nextGameObjectId).initGraphics(renderer, "textures/wall.png");
-    renderer.drawObjects.emplace(nextGameObjectId, &objects.at(nextGameObjectId));
+    objects.emplace(nextGameObjectId, GameObject(renderer, nextGameObjectId, networkedPlayerConfig, glm::vec3(-5, 5, 0), glm::vec3(1, 3, 1), glm::vec3(0, 0, 0), cubeVertices, cubeIndices, GameObjectTags::NetworkedPlayer));
+    addGraphics(nextGameObjectId, "textures/wall.png");
     objects.at(nextGameObjectId).initPhysics(dynamicsWorld);
     nextGameObjectId++;
     return nextGameObjectId - 1;
@@ -486,8 +1028,16 @@ public:
     auto it = objects.find(id);
     if (it != objects.end())
     {
-      it->second.setPosition(glm::vec3(10000, 10000, 10000));
+      // the mesh and texture registries hold the buffers and image back until the frames using them are done
+      renderer.drawObjects.erase(id);
       it->second.cleanupPhysics(dynamicsWorld);
+      it->second.cleanupGraphics(renderer);
+      objects.erase(it);
+
+      if (taggedPlayer == id)
+      {
+        taggedPlayer = -1;
+      }
     }
     else
     {
@@ -495,6 +1045,27 @@ public:
     }
   }
 
+  // Points objects at textures whose async upload landed since the last frame
+  void applyTextureUploads()
+  {
+    if (!renderer.textureRegistry.pollUploads(renderer.deviceManager.device))
+    {
+      return;
+    }
+
+    for (auto &gameObject : objects)
+    {
+      gameObject.second.applyPendingTexture(renderer);
+    }
+  }
+
+  // Cached textures swap right away, anything else is uploaded in the background and swapped in once ready
+  void setTexture(GameObject &object, const std::string &path)
+  {
+    object.setTexture(renderer, renderer.textureRegistry.acquireAsync(path));
+  }
+
+  // Called from the socket thread, never touches the disk or the GPU since both textures are cached
   void setTagged(int id)
   {
     std::lock_guard<std::mutex> lock(objectsMutex);
@@ -507,10 +1078,10 @@ public:
         if (previousTagger != objects.end())
         {
           std::cout << "Editing previous tagger in setTagged: " << taggedPlayer << std::endl;
-          previousTagger->second.textureManager.updateTexture("textures/wall.png", renderer.deviceManager.device, renderer.deviceManager.physicalDevice, renderer.commandPool, renderer.graphicsQueue);
+          setTexture(previousTagger->second, "textures/wall.png");
         }
       }
-      it->second.textureManager.updateTexture("textures/fire.png", renderer.deviceManager.device, renderer.deviceManager.physicalDevice, renderer.commandPool, renderer.graphicsQueue);
+      setTexture(it->second, "textures/fire.png");
       taggedPlayer = id;
     }
     else
@@ -527,7 +1098,7 @@ public:
     if (previousTagger != objects.end())
     {
       std::cout << "Editing previous tagger in youAreTagged: " << taggedPlayer << std::endl;
-      previousTagger->second.textureManager.updateTexture("textures/wall.png", renderer.deviceManager.device, renderer.deviceManager.physicalDevice, renderer.commandPool, renderer.graphicsQueue);
+      setTexture(previousTagger->second, "textures/wall.png");
     }
 
     taggedPlayer = -1;
@@ -554,234 +1125,164 @@ public:
 
     float cameraSpeed = 20.0f * deltaTime;
 
-    if (glfwGetKey(renderer.window, GLFW_KEY_W) == GLFW_PRESS)
+    if (input.isDown(INPUT_KEY_W))
       camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(renderer.window, GLFW_KEY_S) == GLFW_PRESS)
+    if (input.isDown(INPUT_KEY_S))
       camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(renderer.window, GLFW_KEY_A) == GLFW_PRESS)
+    if (input.isDown(INPUT_KEY_A))
       camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(renderer.window, GLFW_KEY_D) == GLFW_PRESS)
+    if (input.isDown(INPUT_KEY_D))
       camera.ProcessKeyboard(RIGHT, deltaTime);
   }
 
   void processPlayerInput(GameObject &player)
   {
-    if (glfwGetKey(renderer.window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-      glfwSetWindowShouldClose(renderer.window, true);
-
-    if (glfwGetKey(renderer.window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS && controlPressed == false)
+    if (input.isDown(INPUT_KEY_LEFT_CONTROL) && !crouched)
     {
-      player.setScale(glm::vec3(player.scale.x, player.scale.y / 2, player.scale.z));
+      crouched = player.setScale(glm::vec3(player.scale.x, player.scale.y / 2, player.scale.z));
     }
-    else if (glfwGetKey(renderer.window, GLFW_KEY_LEFT_CONTROL) != GLFW_PRESS && controlPressed == true)
+    else if (!input.isDown(INPUT_KEY_LEFT_CONTROL) && crouched)
     {
-      player.setScale(glm::vec3(player.scale.x, player.scale.y * 2, player.scale.z));
+      // retried every tick until the ceiling is out of the way
+      crouched = !player.setScale(glm::vec3(player.scale.x, player.scale.y * 2, player.scale.z));
     }
 
-    if (glfwGetKey(renderer.window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+    if (input.isDown(INPUT_KEY_LEFT_CONTROL))
     {
       movementState = MovementState::FallingFast;
       if (!grounded)
       {
-        btVector3 force(0, -3, 0);
-        player.rigidBody->applyImpulse(force, btVector3(0, 0, 0));
+        player.characterController->addVelocity(btVector3(0, -FAST_FALL_SPEED, 0));
       }
-      controlPressed = true;
-    }
-    else
-    {
-      controlPressed = false;
     }
 
-    float cameraSpeed = 20.0f * deltaTime;
+    player.characterController->moveAcceleration = btVector3(0, 0, 0);
 
-    if (glfwGetKey(renderer.window, GLFW_KEY_W) == GLFW_PRESS || glfwGetKey(renderer.window, GLFW_KEY_S) == GLFW_PRESS || glfwGetKey(renderer.window, GLFW_KEY_A) == GLFW_PRESS || glfwGetKey(renderer.window, GLFW_KEY_D) == GLFW_PRESS)
+    if (input.isDown(INPUT_KEY_W) || input.isDown(INPUT_KEY_S) || input.isDown(INPUT_KEY_A) || input.isDown(INPUT_KEY_D))
     {
-      float velocity = 100 * player.rigidBody->getMass();
+      float acceleration = 100;
       if (movementState = MovementState::Air)
       {
-        velocity = 80 * player.rigidBody->getMass();
+        acceleration = 80;
       }
       if (movementState = MovementState::FallingFast)
       {
-        currentTime = std::chrono::system_clock::now();
-        std::chrono::seconds duration = std::chrono::duration_cast<std::chrono::seconds>(currentTime.time_since_epoch());
-        long currentTimeInSeconds = duration.count();
-        if (currentTimeInSeconds - lastDashTime >= 1)
+        if (simulationTime - lastDashTime >= 1)
         {
-          velocity = 60 * player.rigidBody->getMass();
+          acceleration = 60;
         }
       }
       btVector3 force(0, 0, 0);
 
       glm::vec3 forward = glm::normalize(glm::vec3(camera.Front.x, 0.0f, camera.Front.z));
-      if (glfwGetKey(renderer.window, GLFW_KEY_W) == GLFW_PRESS && glfwGetKey(renderer.window, GLFW_KEY_S) != GLFW_PRESS)
+      if (input.isDown(INPUT_KEY_W) && !input.isDown(INPUT_KEY_S))
       {
         force += btVector3(forward.x, 0.0f, forward.z);
       }
-      if (glfwGetKey(renderer.window, GLFW_KEY_S) == GLFW_PRESS && glfwGetKey(renderer.window, GLFW_KEY_W) != GLFW_PRESS)
+      if (input.isDown(INPUT_KEY_S) && !input.isDown(INPUT_KEY_W))
       {
         force -= btVector3(forward.x, 0.0f, forward.z);
       }
-      if (glfwGetKey(renderer.window, GLFW_KEY_A) == GLFW_PRESS && glfwGetKey(renderer.window, GLFW_KEY_D) != GLFW_PRESS)
+      if (input.isDown(INPUT_KEY_A) && !input.isDown(INPUT_KEY_D))
       {
         force -= btVector3(camera.Right.x, 0.0f, camera.Right.z);
       }
-      if (glfwGetKey(renderer.window, GLFW_KEY_D) == GLFW_PRESS && glfwGetKey(renderer.window, GLFW_KEY_A) != GLFW_PRESS)
+      if (input.isDown(INPUT_KEY_D) && !input.isDown(INPUT_KEY_A))
       {
         force += btVector3(camera.Right.x, 0.0f, camera.Right.z);
       }
 
-      force = force.normalize() * velocity * speedMultiplier;
+      force = force.normalize() * acceleration * speedMultiplier;
       if (!std::isnan(force.x()) && !std::isnan(force.y()) && !std::isnan(force.z()))
       {
-        float playerHeight = 3.0f;
-        btVector3 feetPosition = player.rigidBody->getCenterOfMassPosition() - btVector3(0, playerHeight / 2, 0);
-        btVector3 headPosition = player.rigidBody->getCenterOfMassPosition() + btVector3(0, playerHeight / 2, 0);
-
-        bool hasHit = false;
-        for (float i = feetPosition.getY() + 0.01; i <= headPosition.getY() + 0.01; i += 1.f)
-        {
-          btVector3 position(feetPosition.getX(), i, feetPosition.getZ());
-          btCollisionWorld::ClosestRayResultCallback rayCallback(position, position + force.normalized());
-          dynamicsWorld->rayTest(position, position + force.normalized(), rayCallback);
-          if (rayCallback.hasHit())
-          {
-            const btRigidBody *rigidBody = dynamic_cast<const btRigidBody *>(rayCallback.m_collisionObject);
-            if (rigidBody)
-            {
-              btScalar mass = rigidBody->getMass();
-              if (mass == 0)
-              {
-                hasHit = true;
-                break;
-              }
-            }
-          }
-        }
-
-        if (!hasHit)
-        {
-          player.rigidBody->applyCentralForce(force);
-          player.rigidBody->activate();
-        }
+        player.characterController->moveAcceleration = force;
       }
     }
 
-    if (glfwGetKey(renderer.window, GLFW_KEY_SPACE) == GLFW_PRESS && !spacePressed)
+    if (input.isDown(INPUT_KEY_SPACE) && !spacePressed)
     {
       if (grounded)
       {
-        btVector3 force(0, 500, 0);
-        player.rigidBody->applyImpulse(force * jumpMultiplier, btVector3(0, 0, 0));
+        player.characterController->jump(JUMP_SPEED * jumpMultiplier);
         dashCount = 1;
       }
 
       bool canWalljump = wallJumpCount > 0 && isTouchingWall(player, dynamicsWorld);
       if (canWalljump && (!grounded || camera.Pitch > 80))
       {
-        btVector3 force(0, 350, 0);
-        player.rigidBody->applyImpulse(force * jumpMultiplier, btVector3(0, 0, 0));
+        player.characterController->jump(WALL_JUMP_SPEED * jumpMultiplier);
         dashCount = 1;
         wallJumpCount--;
       }
 
       spacePressed = true;
     }
-    if (glfwGetKey(renderer.window, GLFW_KEY_SPACE) != GLFW_PRESS)
+    if (!input.isDown(INPUT_KEY_SPACE))
     {
       spacePressed = false;
     }
 
-    if (glfwGetKey(renderer.window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && !shiftPressed && dashCount > 0)
+    if (input.isDown(INPUT_KEY_LEFT_SHIFT) && !shiftPressed && dashCount > 0)
     {
-      float velocity = 100 * player.rigidBody->getMass();
-
       glm::vec3 forward = glm::normalize(glm::vec3(camera.Front.x, 0.0f, camera.Front.z));
-      player.rigidBody->applyImpulse(btVector3(forward.x, forward.y, forward.z) * velocity * speedMultiplier, btVector3(0, 0, 0));
+      player.characterController->dash(btVector3(forward.x, forward.y, forward.z), DASH_SPEED * speedMultiplier);
 
-      currentTime = std::chrono::system_clock::now();
-      std::chrono::seconds duration = std::chrono::duration_cast<std::chrono::seconds>(currentTime.time_since_epoch());
-      long currentTimeInSeconds = duration.count();
-      lastDashTime = currentTimeInSeconds;
+      lastDashTime = simulationTime;
       dashCount--;
       shiftPressed = true;
     }
-    if (glfwGetKey(renderer.window, GLFW_KEY_LEFT_SHIFT) != GLFW_PRESS)
+    if (!input.isDown(INPUT_KEY_LEFT_SHIFT))
     {
       shiftPressed = false;
     }
   }
 
+  static bool isGroundObject(const btCollisionObject *collisionObject)
+  {
+    const btRigidBody *rigidBody = btRigidBody::upcast(collisionObject);
+    return rigidBody && static_cast<GameObject *>(rigidBody->getUserPointer())->tag == GameObjectTags::Ground;
+  }
+
   bool isPlayerGrounded(GameObject &player, btDynamicsWorld *dynamicsWorld)
   {
     float playerHeight = player.scale.y;
-    btVector3 feetPosition = player.rigidBody->getCenterOfMassPosition() - btVector3(0, (playerHeight / 2), 0) + btVector3(0, 1, 0);
+    btVector3 feetPosition = player.characterController->position - btVector3(0, (playerHeight / 2), 0) + btVector3(0, 1, 0);
     btVector3 rayEnd = feetPosition + btVector3(0, -2, 0);
-    btCollisionWorld::AllHitsRayResultCallback rayCallback(feetPosition, rayEnd);
-    dynamicsWorld->rayTest(feetPosition, rayEnd, rayCallback);
 
-    for (int i = 0; i < rayCallback.m_hitFractions.size(); i++)
-    {
-      const btCollisionObject *hitObject = rayCallback.m_collisionObjects[i];
-      const btRigidBody *rigidBody = dynamic_cast<const btRigidBody *>(hitObject);
-
-      if (rigidBody)
-      {
-        GameObject *obj = static_cast<GameObject *>(rigidBody->getUserPointer());
-
-        if (obj->tag == GameObjectTags::Ground)
-        {
-          return true;
-        }
-      }
-    }
+    rayBatch.clear();
+    rayBatch.addRay(feetPosition, rayEnd, isGroundObject, StaticWorldGroup);
+    rayBatch.run(dynamicsWorld);
 
-    return false;
+    return rayBatch.results[0].hasHit();
   }
 
   bool isTouchingWall(GameObject &player, btDynamicsWorld *dynamicsWorld)
   {
+    CharacterController *controller = player.characterController;
 
-    float playerHeight = player.scale.y;
-    btVector3 feetPosition = player.rigidBody->getCenterOfMassPosition() - btVector3(0, playerHeight / 2, 0);
-    btVector3 headPosition = player.rigidBody->getCenterOfMassPosition() + btVector3(0, playerHeight / 2, 0);
-
-    std::vector<btVector3> directions = {
+    const btVector3 directions[4] = {
         btVector3(1, 0, 0),
         btVector3(-1, 0, 0),
         btVector3(0, 0, 1),
         btVector3(0, 0, -1)};
 
+    // the capsule covers feet to head in one query per direction, and reaches as far past its side as
+    // the rays from its centre line used to
+    float reach = 1.0f - controller->capsuleShape->getRadius();
     bool hasHit = false;
     for (const btVector3 &dir : directions)
     {
-      for (float i = feetPosition.getY() + 0.01; i <= headPosition.getY() + 0.01; i += 1.f)
+      SweepResult result;
+      sweepShape(dynamicsWorld, controller->capsuleShape, controller->position, controller->position + dir * reach, controller->collisionObject, result, StaticWorldGroup);
+      wallSweeps++;
+      if (result.hasHit)
       {
-        btVector3 position(feetPosition.getX(), i, feetPosition.getZ());
-        btCollisionWorld::ClosestRayResultCallback rayCallback(position, position + dir);
-        dynamicsWorld->rayTest(position, position + dir, rayCallback);
-        if (rayCallback.hasHit())
-        {
-          const btRigidBody *rigidBody = dynamic_cast<const btRigidBody *>(rayCallback.m_collisionObject);
-          if (rigidBody)
-          {
-            btScalar mass = rigidBody->getMass();
-            if (mass == 0)
-            {
-              hasHit = true;
-              btVector3 wallNormal = rayCallback.m_hitNormalWorld;
-              btVector3 pushDirection = wallNormal.normalized();
-
-              btRigidBody *playerRigidBody = player.rigidBody;
-              playerRigidBody->setLinearVelocity(playerRigidBody->getLinearVelocity() + pushDirection * 10);
-              break;
-            }
-          }
-        }
+        hasHit = true;
+        player.characterController->addVelocity(result.hitNormalWorld.normalized() * 10);
       }
     }
 
+    lastWallCheck = hasHit;
     return hasHit;
   }
 
@@ -800,6 +1301,12 @@ public:
     {
       float fps = frameCount;
       std::cout << "FPS: " << fps << std::endl;
+      std::cout << "Culling: " << renderer.cullingStats.visible << "/" << renderer.cullingStats.total << " visible, " << renderer.cullingStats.drawCalls << " draws, " << renderer.cullingStats.cullMs << " ms, recorded in "
+                << renderer.cullingStats.recordMs << " ms on " << renderer.cullingStats.recordSlices << " threads" << std::endl;
+      if (printPhysicsStats)
+      {
+        physicsProfiler.printSummary(std::cout);
+      }
       frameCount = 0;
       lastTime = currentTime;
     }
@@ -0,0 +1,383 @@
+#include "asyncTextureUploader.hpp"
+#include "bufferManager.hpp"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+void AsyncTextureUploader::init(VkDevice device, VkPhysicalDevice physicalDevice, const QueueFamilyIndices &queueFamilies, VkQueue transferQueue, bool timelineSemaphores, bool compressedTextures)
+{
+  graphicsFamily = queueFamilies.graphicsFamily.value();
+  mipmaps = supportsLinearBlit(VK_FORMAT_R8G8B8A8_SRGB, physicalDevice);
+  this->compressedTextures = compressedTextures;
+
+  if (transferQueue != VK_NULL_HANDLE && queueFamilies.transferFamily.has_value() && timelineSemaphores)
+  {
+    this->transferQueue = transferQueue;
+    transferFamily = queueFamilies.transferFamily.value();
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = transferFamily;
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create transfer command pool!");
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create texture upload timeline semaphore!");
+    }
+
+    transferStaging.init(device, bufferManager.allocator);
+  }
+
+  stopping = false;
+  worker = std::thread(&AsyncTextureUploader::decodeLoop, this);
+}
+
+void AsyncTextureUploader::cleanup(VkDevice device)
+{
+  if (!worker.joinable())
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  worker.join();
+
+  decoded.clear();
+  requests.clear();
+
+  if (usesTransferQueue())
+  {
+    if (recording != VK_NULL_HANDLE)
+    {
+      submitTransfer(device);
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &timelineValue;
+    vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+  }
+  else
+  {
+    bufferManager.uploadContext.wait(device, bufferManager.uploadContext.flush(device));
+  }
+
+  for (TextureUpload &upload : recordingUploads)
+  {
+    destroy(device, upload);
+  }
+  recordingUploads.clear();
+  failedUploads.clear();
+  for (Pending &batch : pending)
+  {
+    for (TextureUpload &upload : batch.uploads)
+    {
+      destroy(device, upload);
+    }
+  }
+  pending.clear();
+
+  if (usesTransferQueue())
+  {
+    vkDestroyCommandPool(device, transferCommandPool, nullptr);
+    vkDestroySemaphore(device, timeline, nullptr);
+    transferStaging.cleanup(device);
+    freeCommandBuffers.clear();
+    transferQueue = VK_NULL_HANDLE;
+  }
+}
+
+void AsyncTextureUploader::request(int key, const std::string &path)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.emplace_back(key, path);
+  }
+  wake.notify_one();
+}
+
+std::vector<TextureUpload> AsyncTextureUploader::poll(VkDevice device)
+{
+  std::vector<Decoded> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ready.swap(decoded);
+  }
+
+  for (Decoded &texture : ready)
+  {
+    upload(device, texture);
+  }
+
+  if (usesTransferQueue())
+  {
+    if (recording != VK_NULL_HANDLE)
+    {
+      submitTransfer(device);
+    }
+  }
+  else if (!recordingUploads.empty())
+  {
+    // recorded into the graphics batch the renderer flushes before this frame's draws
+    pending.push_back({bufferManager.uploadContext.pendingToken(), VK_NULL_HANDLE, std::move(recordingUploads)});
+    recordingUploads.clear();
+  }
+
+  std::vector<TextureUpload> finished;
+  finished.swap(failedUploads);
+  while (!pending.empty() && finished.size() < TEXTURE_SWAPS_PER_FRAME && isComplete(device, pending.front()))
+  {
+    Pending &batch = pending.front();
+    size_t taken = 0;
+    while (taken < batch.uploads.size() && finished.size() < TEXTURE_SWAPS_PER_FRAME)
+    {
+      TextureUpload &upload = batch.uploads[taken++];
+
+      if (usesTransferQueue())
+      {
+        // acquire half of the ownership transfer, the release was the last thing the transfer queue did
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.image = upload.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, upload.mipLevels, 0, 1};
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        VkCommandBuffer commandBuffer = bufferManager.uploadContext.record(device);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        bufferManager.uploadContext.waitTimeline(device, timeline, batch.completion, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        // a baked texture brought every level, a decoded one only the first
+        if (upload.format == VK_FORMAT_R8G8B8A8_SRGB)
+        {
+          generateMipmaps(commandBuffer, upload.image, upload.width, upload.height, upload.mipLevels);
+        }
+        else
+        {
+          transitionImageLayout(commandBuffer, upload.image, upload.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, upload.mipLevels);
+        }
+      }
+      finished.push_back(std::move(upload));
+    }
+    batch.uploads.erase(batch.uploads.begin(), batch.uploads.begin() + taken);
+
+    if (batch.uploads.empty())
+    {
+      if (batch.commandBuffer != VK_NULL_HANDLE)
+      {
+        freeCommandBuffers.push_back(batch.commandBuffer);
+      }
+      pending.pop_front();
+    }
+  }
+  return finished;
+}
+
+void AsyncTextureUploader::destroy(VkDevice device, TextureUpload &upload)
+{
+  vkDestroyImageView(device, upload.view, nullptr);
+  vkDestroyImage(device, upload.image, nullptr);
+  bufferManager.allocator.free(upload.allocation);
+  upload.view = VK_NULL_HANDLE;
+  upload.image = VK_NULL_HANDLE;
+}
+
+void AsyncTextureUploader::decodeLoop()
+{
+  while (true)
+  {
+    std::pair<int, std::string> next;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this]
+                { return stopping || !requests.empty(); });
+      if (stopping)
+      {
+        return;
+      }
+      next = std::move(requests.front());
+      requests.pop_front();
+    }
+
+    Decoded texture{next.first, std::move(next.second), false, {}};
+    texture.loaded = loadTextureData(texture.path, compressedTextures, texture.data);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    decoded.push_back(std::move(texture));
+  }
+}
+
+void AsyncTextureUploader::upload(VkDevice device, Decoded &texture)
+{
+  if (!texture.loaded)
+  {
+    std::cerr << "Error: failed to load texture image " << texture.path << std::endl;
+    TextureUpload failed;
+    failed.key = texture.key;
+    failed.path = std::move(texture.path);
+    failedUploads.push_back(std::move(failed));
+    return;
+  }
+
+  const TextureData &data = texture.data;
+  VkDeviceSize imageSize = data.bytes.size();
+
+  TextureUpload result;
+  result.key = texture.key;
+  result.path = texture.path;
+  result.width = data.width;
+  result.height = data.height;
+  result.format = data.format;
+  result.mipLevels = data.imageMipLevels(mipmaps);
+  result.bytes = data.imageBytes(result.mipLevels);
+  createImage(result.width, result.height, result.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, result.image, result.allocation, bufferManager.allocator, device, result.mipLevels);
+
+  if (usesTransferQueue())
+  {
+    // same rule as the upload context, a batch never holds more than half the ring
+    VkDeviceSize unclaimed = transferStaging.unclaimedBytes();
+    if (unclaimed > 0 && (unclaimed + imageSize + 16) * 2 > transferStaging.capacity())
+    {
+      submitTransfer(device);
+    }
+
+    StagingAllocation staging = transferStaging.allocate(device, imageSize);
+    memcpy(staging.data, data.bytes.data(), static_cast<size_t>(imageSize));
+
+    VkCommandBuffer commandBuffer = beginTransferCommands(device);
+    transitionImageLayout(commandBuffer, result.image, result.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, result.mipLevels);
+    copyTextureLevels(commandBuffer, staging.buffer, staging.offset, result.image, data);
+
+    // release half of the ownership transfer, the graphics queue acquires it once the timeline passes
+    // and blits the remaining levels there
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    barrier.image = result.image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, result.mipLevels, 0, 1};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+  }
+  else
+  {
+    StagingAllocation staging = bufferManager.uploadContext.stage(device, imageSize);
+    memcpy(staging.data, data.bytes.data(), static_cast<size_t>(imageSize));
+
+    VkCommandBuffer commandBuffer = bufferManager.uploadContext.record(device);
+    transitionImageLayout(commandBuffer, result.image, result.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, result.mipLevels);
+    copyTextureLevels(commandBuffer, staging.buffer, staging.offset, result.image, data);
+    finishTextureLevels(commandBuffer, result.image, data, result.mipLevels);
+  }
+
+  texture.data = TextureData{};
+
+  result.view = createImageView(result.image, result.format, VK_IMAGE_ASPECT_COLOR_BIT, device, result.mipLevels);
+  recordingUploads.push_back(std::move(result));
+}
+
+VkCommandBuffer AsyncTextureUploader::beginTransferCommands(VkDevice device)
+{
+  if (recording != VK_NULL_HANDLE)
+  {
+    return recording;
+  }
+
+  if (!freeCommandBuffers.empty())
+  {
+    recording = freeCommandBuffers.back();
+    freeCommandBuffers.pop_back();
+  }
+  else
+  {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = transferCommandPool;
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, &recording) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to allocate transfer command buffer!");
+    }
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  if (vkBeginCommandBuffer(recording, &beginInfo) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to begin recording transfer command buffer!");
+  }
+  return recording;
+}
+
+void AsyncTextureUploader::submitTransfer(VkDevice device)
+{
+  if (vkEndCommandBuffer(recording) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to record transfer command buffer!");
+  }
+
+  timelineValue++;
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &timelineValue;
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineInfo;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &recording;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &timeline;
+
+  if (vkQueueSubmit(transferQueue, 1, &submitInfo, transferStaging.claimFence(device)) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to submit texture upload!");
+  }
+
+  pending.push_back({timelineValue, recording, std::move(recordingUploads)});
+  recordingUploads.clear();
+  recording = VK_NULL_HANDLE;
+}
+
+bool AsyncTextureUploader::isComplete(VkDevice device, const Pending &batch)
+{
+  if (usesTransferQueue())
+  {
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(device, timeline, &value);
+    return value >= batch.completion;
+  }
+  return bufferManager.uploadContext.isComplete(device, batch.completion);
+}
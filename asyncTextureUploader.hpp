@@ -0,0 +1,101 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "gpuAllocator.hpp"
+#include "stagingRing.hpp"
+#include "uploadContext.hpp"
+#include "textureFile.hpp"
+#include "utils.h"
+
+#define TEXTURE_SWAPS_PER_FRAME 4 // finished uploads handed out per poll, bounds the images being retired
+
+class BufferManager;
+
+// An image that finished uploading and is in SHADER_READ_ONLY_OPTIMAL on the graphics queue, or a
+// null image when the file could not be decoded
+struct TextureUpload
+{
+  int key; // whatever the requester passed, the TextureRegistry uses its handle
+  std::string path;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t mipLevels = 1;
+  VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+  VkDeviceSize bytes = 0;
+  VkImage image = VK_NULL_HANDLE;
+  GpuAllocation allocation;
+  VkImageView view = VK_NULL_HANDLE;
+};
+
+// Loads textures on a worker thread and uploads them without stalling the frame. With a
+// transfer-only queue and timeline semaphores the copy runs on that queue and ownership is handed
+// to the graphics queue afterwards, otherwise it rides along in the UploadContext's next batch.
+// Mip levels are blitted on the graphics queue either way, a transfer queue can't blit.
+class AsyncTextureUploader
+{
+public:
+  AsyncTextureUploader(BufferManager &bufferManager) : bufferManager(bufferManager)
+  {
+  }
+
+  void init(VkDevice device, VkPhysicalDevice physicalDevice, const QueueFamilyIndices &queueFamilies, VkQueue transferQueue, bool timelineSemaphores, bool compressedTextures);
+  void cleanup(VkDevice device); // safe to call twice, needs the allocator and upload context alive
+
+  // Thread safe, only queues the work
+  void request(int key, const std::string &path);
+  // Main thread, once per frame: uploads what has been decoded and returns what the GPU has finished
+  std::vector<TextureUpload> poll(VkDevice device);
+  void destroy(VkDevice device, TextureUpload &upload);
+
+  bool usesTransferQueue() const { return transferQueue != VK_NULL_HANDLE; }
+
+private:
+  struct Decoded
+  {
+    int key;
+    std::string path;
+    bool loaded; // false when neither the .ktx2 nor the PNG could be read
+    TextureData data;
+  };
+
+  struct Pending
+  {
+    uint64_t completion; // timeline value on the transfer path, UploadToken otherwise
+    VkCommandBuffer commandBuffer;
+    std::vector<TextureUpload> uploads;
+  };
+
+  BufferManager &bufferManager;
+  uint32_t graphicsFamily = 0;
+  uint32_t transferFamily = 0;
+  VkQueue transferQueue = VK_NULL_HANDLE;
+  VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+  VkSemaphore timeline = VK_NULL_HANDLE;
+  uint64_t timelineValue = 0;
+  bool mipmaps = false;
+  bool compressedTextures = false;
+  StagingRing transferStaging; // kept apart from the graphics ring so its fences only cover transfer submits
+  VkCommandBuffer recording = VK_NULL_HANDLE;
+  std::vector<TextureUpload> recordingUploads;
+  std::vector<TextureUpload> failedUploads; // handed out by the next poll, nothing to wait for
+  std::deque<Pending> pending;
+  std::vector<VkCommandBuffer> freeCommandBuffers;
+
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<std::pair<int, std::string>> requests;
+  std::vector<Decoded> decoded;
+  bool stopping = false;
+
+  void decodeLoop();
+  void upload(VkDevice device, Decoded &texture);
+  VkCommandBuffer beginTransferCommands(VkDevice device);
+  void submitTransfer(VkDevice device);
+  bool isComplete(VkDevice device, const Pending &batch);
+};
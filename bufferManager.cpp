@@ -3,208 +3,134 @@
 #include <stdexcept>
 #include <chrono>
 
-void BufferManager::createUniformBuffers(int MAX_FRAMES_IN_FLIGHT, VkDevice device, VkPhysicalDevice physicalDevice, int count)
+void BufferManager::createUniformBuffers(int MAX_FRAMES_IN_FLIGHT, VkDevice device, VkPhysicalDevice physicalDevice)
 {
-  VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+  VkDeviceSize bufferSize = sizeof(CameraUniformBufferObject);
 
-  uniformBuffers.resize(uniformBuffers.size() + MAX_FRAMES_IN_FLIGHT * count);
-  uniformBuffersMemory.resize(uniformBuffersMemory.size() + MAX_FRAMES_IN_FLIGHT * count);
-  uniformBuffersMapped.resize(uniformBuffersMapped.size() + MAX_FRAMES_IN_FLIGHT * count);
+  uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  uniformBufferAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+  uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
 
-  for (size_t i = uniformBuffers.size() - MAX_FRAMES_IN_FLIGHT * count; i < uniformBuffers.size(); i++)
+  for (size_t i = 0; i < uniformBuffers.size(); i++)
   {
-    createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i], device, physicalDevice);
+    createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBufferAllocations[i], device);
 
-    vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+    uniformBuffersMapped[i] = uniformBufferAllocations[i].mapped;
   }
 }
 
-void BufferManager::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory, VkDevice device, VkPhysicalDevice physicalDevice)
+void BufferManager::reserveInstanceBuffer(uint32_t currentImage, size_t instanceCount, VkDevice device, VkPhysicalDevice physicalDevice)
 {
-  VkBufferCreateInfo bufferInfo{};
-  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-  bufferInfo.size = size;
-  bufferInfo.usage = usage;
-  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-  if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+  if (instanceBuffers.size() <= currentImage)
   {
-    throw std::runtime_error("failed to create buffer!");
+    instanceBuffers.resize(currentImage + 1, VK_NULL_HANDLE);
+    instanceBufferAllocations.resize(currentImage + 1);
+    instanceBuffersMapped.resize(currentImage + 1, nullptr);
+    instanceBufferCapacity.resize(currentImage + 1, 0);
   }
 
-  VkMemoryRequirements memRequirements;
-  vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, physicalDevice);
-
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+  if (instanceCount <= instanceBufferCapacity[currentImage])
   {
-    throw std::runtime_error("failed to allocate buffer memory!");
+    return;
   }
 
-  vkBindBufferMemory(device, buffer, bufferMemory, 0);
-}
-
-void BufferManager::createIndexBuffer(std::vector<uint32_t> inputIndices, int targetBuffer, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue)
-{
-  if (indexBuffers.size() <= targetBuffer)
+  if (instanceBuffers[currentImage] != VK_NULL_HANDLE)
   {
-    indexBuffers.resize(targetBuffer + 1, VK_NULL_HANDLE);
-    indexBufferMemory.resize(targetBuffer + 1, VK_NULL_HANDLE);
+    vkDestroyBuffer(device, instanceBuffers[currentImage], nullptr);
+    allocator.free(instanceBufferAllocations[currentImage]);
   }
 
-  VkDeviceSize bufferSize = sizeof(inputIndices[0]) * inputIndices.size();
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, device, physicalDevice);
-
-  void *data;
-  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, inputIndices.data(), (size_t)bufferSize);
-  vkUnmapMemory(device, stagingBufferMemory);
-
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffers[targetBuffer], indexBufferMemory[targetBuffer], device, physicalDevice);
-
-  copyBuffer(stagingBuffer, indexBuffers[targetBuffer], bufferSize, device, commandPool, graphicsQueue);
+  size_t capacity = 64;
+  while (capacity < instanceCount)
+  {
+    capacity *= 2;
+  }
 
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
+  VkDeviceSize bufferSize = sizeof(InstanceData) * capacity;
+  createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[currentImage], instanceBufferAllocations[currentImage], device);
+  instanceBuffersMapped[currentImage] = instanceBufferAllocations[currentImage].mapped;
+  instanceBufferCapacity[currentImage] = capacity;
 }
 
-void BufferManager::createVertexBuffer(std::vector<Vertex> verts, int targetBuffer, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue)
+void BufferManager::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, GpuAllocation &bufferAllocation, VkDevice device)
 {
-  if (vertexBuffers.size() <= targetBuffer)
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = size;
+  bufferInfo.usage = usage;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
   {
-    vertexBuffers.resize(targetBuffer + 1, VK_NULL_HANDLE);
-    vertexBufferMemory.resize(targetBuffer + 1, VK_NULL_HANDLE);
+    throw std::runtime_error("failed to create buffer!");
   }
 
-  VkDeviceSize bufferSize = sizeof(verts[0]) * verts.size();
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, device, physicalDevice);
-
-  void *data;
-  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, verts.data(), (size_t)bufferSize);
-  vkUnmapMemory(device, stagingBufferMemory);
-
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffers[targetBuffer], vertexBufferMemory[targetBuffer], device, physicalDevice);
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-  copyBuffer(stagingBuffer, vertexBuffers[targetBuffer], bufferSize, device, commandPool, graphicsQueue);
+  bufferAllocation = allocator.allocate(memRequirements, properties, true);
 
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
+  vkBindBufferMemory(device, buffer, bufferAllocation.memory, bufferAllocation.offset);
 }
 
-void BufferManager::freeVertexBuffer(int index, VkDevice device)
+void BufferManager::createIndexBuffer(const void *indexData, VkDeviceSize bufferSize, VkBuffer &indexBuffer, GpuAllocation &indexBufferAllocation, VkDevice device)
 {
-  if (index < 0 || index >= vertexBuffers.size())
-  {
-    return;
-  }
+  StagingAllocation staging = uploadContext.stage(device, bufferSize);
+  memcpy(staging.data, indexData, (size_t)bufferSize);
 
-  if (vertexBuffers[index] != VK_NULL_HANDLE)
-  {
-    vkDestroyBuffer(device, vertexBuffers[index], nullptr);
-  }
+  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation, device);
 
-  if (vertexBufferMemory[index] != VK_NULL_HANDLE)
-  {
-    vkFreeMemory(device, vertexBufferMemory[index], nullptr);
-  }
-
-  vertexBuffers.erase(vertexBuffers.begin() + index);
-  vertexBufferMemory.erase(vertexBufferMemory.begin() + index);
+  copyBuffer(staging.buffer, indexBuffer, bufferSize, device, staging.offset);
 }
 
-void BufferManager::freeIndexBuffer(int index, VkDevice device)
+void BufferManager::createVertexBuffer(const std::vector<Vertex> &verts, VkBuffer &vertexBuffer, GpuAllocation &vertexBufferAllocation, VkDevice device)
 {
-  if (index < 0 || index >= indexBuffers.size())
-  {
-    return;
-  }
-
-  if (indexBuffers[index] != VK_NULL_HANDLE)
-  {
-    vkDestroyBuffer(device, indexBuffers[index], nullptr);
-  }
+  VkDeviceSize bufferSize = sizeof(verts[0]) * verts.size();
+  StagingAllocation staging = uploadContext.stage(device, bufferSize);
+  memcpy(staging.data, verts.data(), (size_t)bufferSize);
 
-  if (indexBufferMemory[index] != VK_NULL_HANDLE)
-  {
-    vkFreeMemory(device, indexBufferMemory[index], nullptr);
-  }
+  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation, device);
 
-  indexBuffers.erase(indexBuffers.begin() + index);
-  indexBufferMemory.erase(indexBufferMemory.begin() + index);
+  copyBuffer(staging.buffer, vertexBuffer, bufferSize, device, staging.offset);
 }
 
-void BufferManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue)
+void BufferManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDevice device, VkDeviceSize srcOffset)
 {
-  VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
-
   VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = srcOffset;
   copyRegion.size = size;
-  vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-  endSingleTimeCommands(commandBuffer, device, commandPool, graphicsQueue);
+  vkCmdCopyBuffer(uploadContext.record(device), srcBuffer, dstBuffer, 1, &copyRegion);
 }
 
 void BufferManager::cleanup(VkDevice device)
 {
+  uploadContext.cleanup(device);
+  stagingRing.cleanup(device);
+
   for (auto &uniformBuffer : uniformBuffers)
   {
     vkDestroyBuffer(device, uniformBuffer, nullptr);
   }
 
-  for (auto &uniformBufferMemory : uniformBuffersMemory)
-  {
-    vkFreeMemory(device, uniformBufferMemory, nullptr);
-  }
-
-  for (auto &indexBuffer : indexBuffers)
-  {
-    if (indexBuffer != VK_NULL_HANDLE)
-    {
-      vkDestroyBuffer(device, indexBuffer, nullptr);
-      indexBuffer = VK_NULL_HANDLE;
-    }
-  }
-  for (auto &indexBufferMem : indexBufferMemory)
+  for (auto &uniformBufferAllocation : uniformBufferAllocations)
   {
-    if (indexBufferMem != VK_NULL_HANDLE)
-    {
-      vkFreeMemory(device, indexBufferMem, nullptr);
-      indexBufferMem = VK_NULL_HANDLE;
-    }
+    allocator.free(uniformBufferAllocation);
   }
 
-  for (auto &vertexBuffer : vertexBuffers)
-  {
-    if (vertexBuffer != VK_NULL_HANDLE)
-    {
-      vkDestroyBuffer(device, vertexBuffer, nullptr);
-      vertexBuffer = VK_NULL_HANDLE;
-    }
-  }
-  for (auto &vertexBufferMem : vertexBufferMemory)
+  for (size_t i = 0; i < instanceBuffers.size(); i++)
   {
-    if (vertexBufferMem != VK_NULL_HANDLE)
+    if (instanceBuffers[i] != VK_NULL_HANDLE)
     {
-      vkFreeMemory(device, vertexBufferMem, nullptr);
-      vertexBufferMem = VK_NULL_HANDLE;
+      vkDestroyBuffer(device, instanceBuffers[i], nullptr);
+      allocator.free(instanceBufferAllocations[i]);
     }
   }
 }
 
-void BufferManager::updateUniformBuffer(uint32_t currentImage, glm::mat4 transformation, glm::mat4 view, glm::mat4 proj)
+void BufferManager::updateUniformBuffer(uint32_t currentImage, glm::mat4 view, glm::mat4 proj)
 {
-  UniformBufferObject ubo{};
+  CameraUniformBufferObject ubo{};
 
-  ubo.model = transformation;
   ubo.view = view;
 
   ubo.proj = proj;
@@ -2,6 +2,9 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include "vertex.h"
+#include "stagingRing.hpp"
+#include "uploadContext.hpp"
+#include "gpuAllocator.hpp"
 class BufferManager
 {
 public:
@@ -11,26 +14,29 @@ public:
   ~BufferManager()
   {
   }
-  std::vector<VkBuffer> vertexBuffers;
-  std::vector<VkDeviceMemory> vertexBufferMemory;
+  GpuAllocator allocator;   // backs every buffer and image, initialised before anything else is created
+  StagingRing stagingRing; // every vertex, index and texture upload goes through it
+  UploadContext uploadContext; // batches those uploads into a few submits
 
-  std::vector<VkBuffer> indexBuffers;
-  std::vector<VkDeviceMemory> indexBufferMemory;
-
-  std::vector<VkBuffer> uniformBuffers;
-  std::vector<VkDeviceMemory> uniformBuffersMemory;
+  std::vector<VkBuffer> uniformBuffers; // camera UBO, one per frame in flight
+  std::vector<GpuAllocation> uniformBufferAllocations;
   std::vector<void *> uniformBuffersMapped;
 
-  void createUniformBuffers(int MAX_FRAMES_IN_FLIGHT, VkDevice device, VkPhysicalDevice physicalDevice, int count);
-  void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory, VkDevice device, VkPhysicalDevice physicalDevice);
+  std::vector<VkBuffer> instanceBuffers; // per frame in flight, grown on demand
+  std::vector<GpuAllocation> instanceBufferAllocations;
+  std::vector<void *> instanceBuffersMapped;
+  std::vector<size_t> instanceBufferCapacity;
 
-  void freeVertexBuffer(int index, VkDevice device);
-  void freeIndexBuffer(int index, VkDevice device);
+  void createUniformBuffers(int MAX_FRAMES_IN_FLIGHT, VkDevice device, VkPhysicalDevice physicalDevice);
+  void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, GpuAllocation &bufferAllocation, VkDevice device);
 
-  void createVertexBuffer(std::vector<Vertex> verts, int targetBuffer, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
-  void createIndexBuffer(std::vector<uint32_t> inputIndices, int targetBuffer, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
+  // mesh buffers are owned by MeshRegistry, these only create them and record the upload
+  void createVertexBuffer(const std::vector<Vertex> &verts, VkBuffer &vertexBuffer, GpuAllocation &vertexBufferAllocation, VkDevice device);
+  void createIndexBuffer(const void *indexData, VkDeviceSize bufferSize, VkBuffer &indexBuffer, GpuAllocation &indexBufferAllocation, VkDevice device);
 
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue);
+  // recorded into the upload context, the copy runs with its next flush
+  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDevice device, VkDeviceSize srcOffset = 0);
+  void reserveInstanceBuffer(uint32_t currentImage, size_t instanceCount, VkDevice device, VkPhysicalDevice physicalDevice); // only call once the frame's fence has signalled
   void cleanup(VkDevice device);
-  void updateUniformBuffer(uint32_t currentImage, glm::mat4 transformation, glm::mat4 view, glm::mat4 proj);
+  void updateUniformBuffer(uint32_t currentImage, glm::mat4 view, glm::mat4 proj);
 };
\ No newline at end of file
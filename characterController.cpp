@@ -0,0 +1,313 @@
+#include "characterController.hpp"
+#include <LinearMath/btQuickprof.h>
+#include <algorithm>
+#include <cmath>
+
+#define MAX_SLIDE_ITERATIONS 4
+#define MAX_PENETRATION_ITERATIONS 4
+
+struct PenetrationCallback : public btCollisionWorld::ContactResultCallback
+{
+  const btCollisionObject *me;
+  btVector3 correction = btVector3(0, 0, 0);
+  bool penetrating = false;
+
+  PenetrationCallback(const btCollisionObject *me) : me(me)
+  {
+    m_collisionFilterGroup = me->getBroadphaseHandle()->m_collisionFilterGroup;
+    m_collisionFilterMask = me->getBroadphaseHandle()->m_collisionFilterMask;
+  }
+
+  bool needsCollision(btBroadphaseProxy *proxy0) const override
+  {
+    if (!static_cast<const btCollisionObject *>(proxy0->m_clientObject)->hasContactResponse())
+    {
+      return false;
+    }
+
+    return btCollisionWorld::ContactResultCallback::needsCollision(proxy0);
+  }
+
+  btScalar addSingleResult(btManifoldPoint &cp, const btCollisionObjectWrapper *colObj0, int partId0, int index0, const btCollisionObjectWrapper *colObj1, int partId1, int index1) override
+  {
+    if (cp.getDistance() >= 0)
+    {
+      return 0;
+    }
+
+    btVector3 normal = cp.m_normalWorldOnB;
+    if (colObj0->getCollisionObject() != me)
+    {
+      normal = -normal;
+    }
+
+    correction += normal * -cp.getDistance();
+    penetrating = true;
+    return 0;
+  }
+};
+
+CharacterController::CharacterController(btCollisionWorld *collisionWorld, const btVector3 &position, float radius, float height, void *userPointer, int collisionGroup, int collisionMask) : collisionWorld(collisionWorld), position(position), radius(radius), height(height)
+{
+  capsuleShape = new btCapsuleShape(radius, std::max(height - 2 * radius, 0.0f));
+
+  collisionObject = new btCollisionObject();
+  collisionObject->setCollisionShape(capsuleShape);
+  collisionObject->setCollisionFlags(collisionObject->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT | btCollisionObject::CF_CHARACTER_OBJECT);
+  collisionObject->setActivationState(DISABLE_DEACTIVATION);
+  collisionObject->setUserPointer(userPointer);
+
+  btTransform transform;
+  transform.setIdentity();
+  transform.setOrigin(position);
+  collisionObject->setWorldTransform(transform);
+
+  collisionWorld->addCollisionObject(collisionObject, collisionGroup, collisionMask);
+}
+
+CharacterController::~CharacterController()
+{
+  collisionWorld->removeCollisionObject(collisionObject);
+  delete collisionObject;
+  delete capsuleShape;
+}
+
+void CharacterController::update(float deltaTime)
+{
+  BT_PROFILE("CharacterController::update");
+
+  if (deltaTime <= 0)
+  {
+    return;
+  }
+
+  btVector3 horizontalVelocity(velocity.getX() + moveAcceleration.getX() * deltaTime, 0, velocity.getZ() + moveAcceleration.getZ() * deltaTime);
+
+  float speed = horizontalVelocity.length();
+  if (speed > SIMD_EPSILON)
+  {
+    float slowdown = onGround ? std::min(speed, groundFriction * deltaTime) : speed * std::min(1.0f, airDamping * deltaTime);
+    if (speed - slowdown > maxSpeed)
+    {
+      slowdown += (speed - slowdown - maxSpeed) * std::min(1.0f, overspeedDamping * deltaTime);
+    }
+    horizontalVelocity *= (speed - slowdown) / speed;
+  }
+
+  float verticalVelocity = velocity.getY();
+  if (!onGround || verticalVelocity > 0)
+  {
+    verticalVelocity = std::max(verticalVelocity - gravity * deltaTime, -maxFallSpeed);
+  }
+  velocity = btVector3(horizontalVelocity.getX(), verticalVelocity, horizontalVelocity.getZ());
+
+  bool wasOnGround = onGround;
+  float verticalMove = velocity.getY() * deltaTime;
+
+  // lift by the step height (and any upward movement) so small ledges don't block the horizontal move
+  float upDistance = (wasOnGround ? stepHeight : 0) + std::max(verticalMove, 0.0f);
+  float steppedUp = 0;
+  if (upDistance > 0)
+  {
+    SweepResult up;
+    if (sweep(position, position + btVector3(0, upDistance, 0), up))
+    {
+      steppedUp = std::max(upDistance * up.hitFraction - skinWidth, 0.0f);
+      if (velocity.getY() > 0)
+      {
+        velocity.setY(0);
+      }
+    }
+    else
+    {
+      steppedUp = upDistance;
+    }
+    position += btVector3(0, steppedUp, 0);
+  }
+  float stepOffset = wasOnGround ? std::min(steppedUp, stepHeight) : 0;
+
+  // slide along whatever blocks the horizontal move
+  btVector3 horizontalMove(velocity.getX() * deltaTime, 0, velocity.getZ() * deltaTime);
+  for (int i = 0; i < MAX_SLIDE_ITERATIONS && horizontalMove.length2() > SIMD_EPSILON; i++)
+  {
+    SweepResult side;
+    if (!sweep(position, position + horizontalMove, side))
+    {
+      position += horizontalMove;
+      break;
+    }
+
+    float moveLength = horizontalMove.length();
+    btVector3 direction = horizontalMove / moveLength;
+    float travel = std::max(moveLength * side.hitFraction - skinWidth, 0.0f);
+    position += direction * travel;
+
+    pushBody(side.collisionObject, direction);
+
+    btVector3 wallNormal(side.hitNormalWorld.getX(), 0, side.hitNormalWorld.getZ());
+    if (wallNormal.length2() < SIMD_EPSILON)
+    {
+      break;
+    }
+    wallNormal.normalize();
+
+    btVector3 remaining = direction * (moveLength - travel);
+    horizontalMove = remaining - wallNormal * remaining.dot(wallNormal);
+
+    float intoWall = velocity.dot(wallNormal);
+    if (intoWall < 0)
+    {
+      velocity -= wallNormal * intoWall;
+    }
+  }
+
+  // undo the step, fall, and snap down onto walkable ground when we were already standing
+  float fall = std::max(-verticalMove, 0.0f);
+  float snap = (wasOnGround && velocity.getY() <= 0) ? groundSnapDistance : 0;
+  float downDistance = stepOffset + fall + snap;
+  onGround = false;
+  if (downDistance > 0)
+  {
+    SweepResult down;
+    if (!sweep(position, position - btVector3(0, downDistance, 0), down))
+    {
+      position -= btVector3(0, stepOffset + fall, 0);
+    }
+    else
+    {
+      float travel = std::max(downDistance * down.hitFraction - skinWidth, 0.0f);
+      position -= btVector3(0, travel, 0);
+
+      if (down.hitNormalWorld.getY() >= std::cos(maxSlopeDegrees * SIMD_RADS_PER_DEG))
+      {
+        onGround = true;
+        groundNormal = down.hitNormalWorld;
+        if (velocity.getY() < 0)
+        {
+          velocity.setY(0);
+        }
+      }
+      else
+      {
+        // too steep to stand on, slide the rest of the fall along the slope
+        btVector3 remaining(0, -std::max(stepOffset + fall - travel, 0.0f), 0);
+        btVector3 slideMove = remaining - down.hitNormalWorld * remaining.dot(down.hitNormalWorld);
+        SweepResult slide;
+        if (slideMove.length2() > SIMD_EPSILON)
+        {
+          if (sweep(position, position + slideMove, slide))
+          {
+            position += slideMove * std::max(slide.hitFraction - skinWidth / slideMove.length(), btScalar(0));
+          }
+          else
+          {
+            position += slideMove;
+          }
+        }
+      }
+    }
+  }
+
+  if (penetrating)
+  {
+    recoverFromPenetration();
+  }
+
+  syncTransform();
+}
+
+void CharacterController::warp(const btVector3 &newPosition)
+{
+  position = newPosition;
+  velocity = btVector3(0, 0, 0);
+  onGround = false;
+  syncTransform();
+}
+
+bool CharacterController::setHeight(float newHeight)
+{
+  // with the feet staying put the top of the capsule moves by the whole difference, sweeping the
+  // current capsule that far up covers everything the taller one would overlap
+  float growth = newHeight - height;
+  SweepResult up;
+  if (growth > 0 && sweep(position, position + btVector3(0, growth + skinWidth, 0), up))
+  {
+    return false;
+  }
+
+  height = newHeight;
+  position.setY(position.getY() + growth / 2);
+
+  delete capsuleShape;
+  capsuleShape = new btCapsuleShape(radius, std::max(height - 2 * radius, 0.0f));
+  collisionObject->setCollisionShape(capsuleShape);
+  syncTransform();
+  return true;
+}
+
+void CharacterController::jump(float speed)
+{
+  velocity.setY(velocity.getY() + speed);
+  onGround = false;
+}
+
+void CharacterController::dash(const btVector3 &direction, float speed)
+{
+  velocity += direction * speed;
+}
+
+void CharacterController::addVelocity(const btVector3 &deltaVelocity)
+{
+  velocity += deltaVelocity;
+}
+
+bool CharacterController::sweep(const btVector3 &from, const btVector3 &to, SweepResult &result)
+{
+  sweepShape(collisionWorld, capsuleShape, from, to, collisionObject, result);
+
+  if (result.hasHit && result.hitFraction <= 0)
+  {
+    penetrating = true;
+  }
+
+  return result.hasHit;
+}
+
+void CharacterController::pushBody(const btCollisionObject *hitObject, const btVector3 &direction)
+{
+  btRigidBody *rigidBody = btRigidBody::upcast(const_cast<btCollisionObject *>(hitObject));
+  if (rigidBody && !rigidBody->isStaticOrKinematicObject())
+  {
+    rigidBody->activate();
+    rigidBody->applyCentralImpulse(direction * pushImpulse);
+  }
+}
+
+void CharacterController::recoverFromPenetration()
+{
+  // only runs after a sweep started inside something, so the common frame does no contact query
+  penetrating = false;
+
+  for (int i = 0; i < MAX_PENETRATION_ITERATIONS; i++)
+  {
+    syncTransform();
+
+    PenetrationCallback callback(collisionObject);
+    collisionWorld->contactTest(collisionObject, callback);
+    if (!callback.penetrating)
+    {
+      break;
+    }
+
+    position += callback.correction;
+  }
+}
+
+void CharacterController::syncTransform()
+{
+  btTransform transform;
+  transform.setIdentity();
+  transform.setOrigin(position);
+  collisionObject->setWorldTransform(transform);
+  collisionWorld->updateSingleAabb(collisionObject);
+}
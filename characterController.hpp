@@ -0,0 +1,54 @@
+#pragma once
+#include <btBulletDynamicsCommon.h>
+#include "physicsQueries.hpp"
+
+// Kinematic capsule character moved with shape sweeps instead of forces. Handles step-up, slope
+// limits and ground snapping itself and only depends on the collision world, so it can run without
+// a renderer (e.g. on the server).
+class CharacterController
+{
+public:
+  btCollisionObject *collisionObject = nullptr;
+  btCapsuleShape *capsuleShape = nullptr;
+
+  btVector3 position;
+  btVector3 velocity = btVector3(0, 0, 0);
+  btVector3 moveAcceleration = btVector3(0, 0, 0); // horizontal, set by input every frame
+  btVector3 groundNormal = btVector3(0, 1, 0);
+  bool onGround = false;
+
+  float gravity = 20.0f;
+  float maxFallSpeed = 55.0f;
+  float maxSpeed = 12.0f;
+  float overspeedDamping = 10.0f; // how fast speed above maxSpeed (e.g. after a dash) bleeds off
+  float groundFriction = 32.0f;
+  float airDamping = 0.1f;
+  float stepHeight = 0.35f;
+  float maxSlopeDegrees = 50.0f;
+  float groundSnapDistance = 0.3f;
+  float skinWidth = 0.02f;
+  float pushImpulse = 5.0f;
+
+  CharacterController(btCollisionWorld *collisionWorld, const btVector3 &position, float radius, float height, void *userPointer = nullptr, int collisionGroup = btBroadphaseProxy::CharacterFilter, int collisionMask = btBroadphaseProxy::AllFilter);
+  ~CharacterController();
+
+  void update(float deltaTime);
+  void warp(const btVector3 &newPosition);
+  bool setHeight(float newHeight); // keeps the feet in place, false when something above leaves no room to grow
+
+  // gameplay hooks, all take effect on the next update
+  void jump(float speed); // adds upward speed, also used for wall jumps
+  void dash(const btVector3 &direction, float speed);
+  void addVelocity(const btVector3 &deltaVelocity);
+
+private:
+  btCollisionWorld *collisionWorld;
+  float radius;
+  float height;
+  bool penetrating = false;
+
+  bool sweep(const btVector3 &from, const btVector3 &to, SweepResult &result);
+  void pushBody(const btCollisionObject *hitObject, const btVector3 &direction);
+  void recoverFromPenetration();
+  void syncTransform();
+};
@@ -0,0 +1,119 @@
+#include "descriptorAllocator.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+void DescriptorAllocator::init(uint32_t initialSets, const std::vector<DescriptorPoolRatio> &poolRatios)
+{
+  ratios = poolRatios;
+  setsPerPool = std::max(initialSets, 1u);
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDevice device, VkDescriptorSetLayout layout)
+{
+  VkDescriptorPool pool = takePool(device);
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = pool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+
+  VkDescriptorSet descriptorSet;
+  VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+
+  // moves down the chain, a pool created just now always has room for one set
+  bool freshPool = false;
+  while ((result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) && !freshPool)
+  {
+    fullPools.push_back(pool);
+    freshPool = readyPools.empty();
+    pool = takePool(device);
+    allocInfo.descriptorPool = pool;
+    result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+  }
+
+  if (result != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate descriptor set!");
+  }
+
+  readyPools.push_back(pool);
+  setsAllocated++;
+  return descriptorSet;
+}
+
+void DescriptorAllocator::reset(VkDevice device)
+{
+  for (VkDescriptorPool pool : readyPools)
+  {
+    vkResetDescriptorPool(device, pool, 0);
+  }
+  for (VkDescriptorPool pool : fullPools)
+  {
+    vkResetDescriptorPool(device, pool, 0);
+    readyPools.push_back(pool);
+  }
+  fullPools.clear();
+  setsAllocated = 0;
+}
+
+DescriptorAllocatorStats DescriptorAllocator::stats() const
+{
+  DescriptorAllocatorStats stats;
+  stats.pools = readyPools.size() + fullPools.size();
+  stats.setsAllocated = setsAllocated;
+  stats.poolsCreated = poolsCreated;
+  return stats;
+}
+
+void DescriptorAllocator::cleanup(VkDevice device)
+{
+  for (VkDescriptorPool pool : readyPools)
+  {
+    vkDestroyDescriptorPool(device, pool, nullptr);
+  }
+  for (VkDescriptorPool pool : fullPools)
+  {
+    vkDestroyDescriptorPool(device, pool, nullptr);
+  }
+  readyPools.clear();
+  fullPools.clear();
+  setsAllocated = 0;
+}
+
+VkDescriptorPool DescriptorAllocator::takePool(VkDevice device)
+{
+  if (!readyPools.empty())
+  {
+    VkDescriptorPool pool = readyPools.back();
+    readyPools.pop_back();
+    return pool;
+  }
+
+  VkDescriptorPool pool = createPool(device, setsPerPool);
+  setsPerPool = std::min(setsPerPool * 2, static_cast<uint32_t>(MAX_SETS_PER_POOL));
+  return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(VkDevice device, uint32_t setCount)
+{
+  std::vector<VkDescriptorPoolSize> poolSizes;
+  for (const DescriptorPoolRatio &ratio : ratios)
+  {
+    poolSizes.push_back({ratio.type, std::max(static_cast<uint32_t>(ratio.perSet * setCount), 1u)});
+  }
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = setCount;
+
+  VkDescriptorPool pool;
+  if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create descriptor pool!");
+  }
+  poolsCreated++;
+  return pool;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#define MAX_SETS_PER_POOL 4096 // pools double in size up to this
+
+struct DescriptorPoolRatio
+{
+  VkDescriptorType type;
+  float perSet; // descriptors of this type reserved for every set the pool holds
+};
+
+struct DescriptorAllocatorStats
+{
+  size_t pools = 0;
+  size_t setsAllocated = 0; // since the last reset
+  size_t poolsCreated = 0;  // over its whole life, only goes up when every pool was full
+};
+
+// Hands out descriptor sets from a chain of pools. A pool that reports it is out of memory is set
+// aside and the set comes from the next one, creating it at twice the size of the last when none
+// is left, so nothing has to know how many sets it will need. reset() recycles every pool at once.
+class DescriptorAllocator
+{
+public:
+  void init(uint32_t initialSets, const std::vector<DescriptorPoolRatio> &ratios);
+
+  VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout);
+  // Returns every pool to the chain empty, the sets allocated so far must no longer be in use
+  void reset(VkDevice device);
+
+  DescriptorAllocatorStats stats() const;
+  void cleanup(VkDevice device);
+
+private:
+  std::vector<DescriptorPoolRatio> ratios;
+  std::vector<VkDescriptorPool> readyPools; // may still have room
+  std::vector<VkDescriptorPool> fullPools;  // wait for the next reset
+  uint32_t setsPerPool = 0;                 // size of the next pool created
+  size_t setsAllocated = 0;
+  size_t poolsCreated = 0;
+
+  VkDescriptorPool takePool(VkDevice device);
+  VkDescriptorPool createPool(VkDevice device, uint32_t setCount);
+};
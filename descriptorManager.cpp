@@ -3,9 +3,8 @@
 #include <stdexcept>
 #include "utils.h"
 #include "bufferManager.hpp"
-#include "textureManager.hpp"
 
-void DescriptorManager::createDescriptorSetLayout(VkDevice device)
+void DescriptorManager::createDescriptorSetLayouts(VkDevice device)
 {
   VkDescriptorSetLayoutBinding uboLayoutBinding{};
   uboLayoutBinding.binding = 0;
@@ -13,150 +12,128 @@ void DescriptorManager::createDescriptorSetLayout(VkDevice device)
   uboLayoutBinding.descriptorCount = 1;
   uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+  VkDescriptorSetLayoutCreateInfo cameraLayoutInfo{};
+  cameraLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  cameraLayoutInfo.bindingCount = 1;
+  cameraLayoutInfo.pBindings = &uboLayoutBinding;
+
+  if (vkCreateDescriptorSetLayout(device, &cameraLayoutInfo, nullptr, &cameraSetLayout) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create camera descriptor set layout!");
+  }
+
   VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-  samplerLayoutBinding.binding = 1;
-  samplerLayoutBinding.descriptorCount = 1;
+  samplerLayoutBinding.binding = 0;
+  samplerLayoutBinding.descriptorCount = MAX_BINDLESS_TEXTURES;
   samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   samplerLayoutBinding.pImmutableSamplers = nullptr;
   samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
-  VkDescriptorSetLayoutCreateInfo layoutInfo{};
-  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-  layoutInfo.pBindings = bindings.data();
-
-  if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+  // free slots stay unwritten, and textures are added while earlier frames that bound the set are still running
+  VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+  bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsInfo.bindingCount = 1;
+  bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+  VkDescriptorSetLayoutCreateInfo textureLayoutInfo{};
+  textureLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  textureLayoutInfo.pNext = &bindingFlagsInfo;
+  textureLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  textureLayoutInfo.bindingCount = 1;
+  textureLayoutInfo.pBindings = &samplerLayoutBinding;
+
+  if (vkCreateDescriptorSetLayout(device, &textureLayoutInfo, nullptr, &textureSetLayout) != VK_SUCCESS)
   {
-    throw std::runtime_error("failed to create descriptor set layout!");
+    throw std::runtime_error("failed to create texture descriptor set layout!");
   }
 }
 
-void DescriptorManager::createDescriptorPool(VkDevice device, int MAX_FRAMES_IN_FLIGHT, int count)
+void DescriptorManager::createDescriptorPools(VkDevice device, int MAX_FRAMES_IN_FLIGHT)
 {
+  persistentAllocator.init(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT), {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f}});
 
-  std::array<VkDescriptorPoolSize, 2> poolSizes{};
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * count);
-  poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * count);
+  VkDescriptorPoolSize texturePoolSize{};
+  texturePoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  texturePoolSize.descriptorCount = MAX_BINDLESS_TEXTURES;
 
-  VkDescriptorPoolCreateInfo poolInfo{};
-  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-  poolInfo.pPoolSizes = poolSizes.data();
-  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * count);
+  VkDescriptorPoolCreateInfo texturePoolInfo{};
+  texturePoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  texturePoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  texturePoolInfo.poolSizeCount = 1;
+  texturePoolInfo.pPoolSizes = &texturePoolSize;
+  texturePoolInfo.maxSets = 1;
 
-  if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+  if (vkCreateDescriptorPool(device, &texturePoolInfo, nullptr, &texturePool) != VK_SUCCESS)
   {
-    throw std::runtime_error("failed to create descriptor pool!");
+    throw std::runtime_error("failed to create texture descriptor pool!");
   }
 }
 
-void DescriptorManager::createDescriptorSets(VkDevice device, int MAX_FRAMES_IN_FLIGHT, int count, TextureManager &textureManager)
+void DescriptorManager::createCameraDescriptorSets(VkDevice device, int MAX_FRAMES_IN_FLIGHT)
 {
-  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT * count, descriptorSetLayout);
-  VkDescriptorSetAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = descriptorPool;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-  allocInfo.pSetLayouts = layouts.data();
-
-  descriptorSets.resize(layouts.size());
-  if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+  // the contents never change, so every frame in flight keeps its set for good
+  cameraDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
   {
-    throw std::runtime_error("failed to allocate descriptor sets!");
-  }
+    cameraDescriptorSets[i] = persistentAllocator.allocate(device, cameraSetLayout);
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT * count; i++)
-  {
     VkDescriptorBufferInfo bufferInfo{};
     bufferInfo.buffer = bufferManager.uniformBuffers[i];
     bufferInfo.offset = 0;
-    bufferInfo.range = sizeof(UniformBufferObject);
-
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = textureManager.textureImageView;
-    imageInfo.sampler = textureManager.textureSampler;
-
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = descriptorSets[i];
-    descriptorWrites[0].dstBinding = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = descriptorSets[i];
-    descriptorWrites[1].dstBinding = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = 1;
-    descriptorWrites[1].pImageInfo = &imageInfo;
-
-    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    bufferInfo.range = sizeof(CameraUniformBufferObject);
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = cameraDescriptorSets[i];
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
   }
 }
 
-void DescriptorManager::addDescriptorSets(VkDevice device, int MAX_FRAMES_IN_FLIGHT, int count, TextureManager &textureManager)
+void DescriptorManager::createTextureDescriptorSet(VkDevice device)
 {
-  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT * count, descriptorSetLayout);
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = descriptorPool;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-  allocInfo.pSetLayouts = layouts.data();
-
-  std::vector<VkDescriptorSet> newDescriptorSets;
-  newDescriptorSets.resize(layouts.size());
-  size_t previousSetsSize = descriptorSets.size();
-  if (vkAllocateDescriptorSets(device, &allocInfo, newDescriptorSets.data()) != VK_SUCCESS)
-  {
-    throw std::runtime_error("failed to allocate added descriptor sets!");
-  }
+  allocInfo.descriptorPool = texturePool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &textureSetLayout;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT * count; i++)
+  if (vkAllocateDescriptorSets(device, &allocInfo, &textureDescriptorSet) != VK_SUCCESS)
   {
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = bufferManager.uniformBuffers[i + previousSetsSize];
-    bufferInfo.offset = 0;
-    bufferInfo.range = sizeof(UniformBufferObject);
-
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = textureManager.textureImageView;
-    imageInfo.sampler = textureManager.textureSampler;
-
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = newDescriptorSets[i];
-    descriptorWrites[0].dstBinding = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = newDescriptorSets[i];
-    descriptorWrites[1].dstBinding = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = 1;
-    descriptorWrites[1].pImageInfo = &imageInfo;
-
-    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    throw std::runtime_error("failed to allocate texture descriptor set!");
   }
-  descriptorSets.reserve(descriptorSets.size() + newDescriptorSets.size());
-  descriptorSets.insert(descriptorSets.end(), newDescriptorSets.begin(), newDescriptorSets.end());
+}
+
+void DescriptorManager::writeTexture(VkDevice device, uint32_t index, VkImageView imageView, VkSampler sampler)
+{
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  imageInfo.imageView = imageView;
+  imageInfo.sampler = sampler;
+
+  VkWriteDescriptorSet descriptorWrite{};
+  descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrite.dstSet = textureDescriptorSet;
+  descriptorWrite.dstBinding = 0;
+  descriptorWrite.dstArrayElement = index;
+  descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.pImageInfo = &imageInfo;
+
+  vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
 }
 
 void DescriptorManager::cleanup(VkDevice device)
 {
-  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-  vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+  persistentAllocator.cleanup(device);
+  cameraDescriptorSets.clear();
+  vkDestroyDescriptorPool(device, texturePool, nullptr);
+  vkDestroyDescriptorSetLayout(device, cameraSetLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, textureSetLayout, nullptr);
 }
\ No newline at end of file
@@ -1,15 +1,23 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <vector>
+#include "descriptorAllocator.hpp"
+
+// Size of the bindless texture array, a texture's handle is its index into it
+#define MAX_BINDLESS_TEXTURES 1024
 
 class BufferManager;
-class TextureManager;
 class DescriptorManager
 {
 public:
-  VkDescriptorSetLayout descriptorSetLayout;
-  VkDescriptorPool descriptorPool;
-  std::vector<VkDescriptorSet> descriptorSets;
+  // set 0 holds the per-frame camera UBO shared by every draw, set 1 every texture in one array that
+  // instances index into, so both are bound once per frame
+  VkDescriptorSetLayout cameraSetLayout;
+  VkDescriptorSetLayout textureSetLayout;
+  DescriptorAllocator persistentAllocator; // never reset, for sets written once like the camera sets
+  VkDescriptorPool texturePool;            // update after bind, holds only textureDescriptorSet
+  std::vector<VkDescriptorSet> cameraDescriptorSets; // one per frame in flight
+  VkDescriptorSet textureDescriptorSet;
   BufferManager &bufferManager;
   DescriptorManager(BufferManager &bufferManager) : bufferManager(bufferManager)
   {
@@ -17,9 +25,12 @@ public:
   ~DescriptorManager()
   {
   }
-  void createDescriptorSetLayout(VkDevice device);
-  void createDescriptorPool(VkDevice device, int MAX_FRAMES_IN_FLIGHT, int count);
-  void createDescriptorSets(VkDevice device, int MAX_FRAMES_IN_FLIGHT, int count, TextureManager &textureManager);
-  void addDescriptorSets(VkDevice device, int MAX_FRAMES_IN_FLIGHT, int count, TextureManager &textureManager);
+  void createDescriptorSetLayouts(VkDevice device);
+  void createDescriptorPools(VkDevice device, int MAX_FRAMES_IN_FLIGHT);
+  void createCameraDescriptorSets(VkDevice device, int MAX_FRAMES_IN_FLIGHT);
+  void createTextureDescriptorSet(VkDevice device);
+  // Points element index of the texture array at imageView. Allowed while frames using the set are in
+  // flight, as long as none of them samples that element.
+  void writeTexture(VkDevice device, uint32_t index, VkImageView imageView, VkSampler sampler);
   void cleanup(VkDevice device);
 };
\ No newline at end of file
@@ -3,13 +3,19 @@
 #include <set>
 #include <stdexcept>
 #include "swapchainManager.hpp"
+#include "descriptorManager.hpp"
 
-void DeviceManager::createLogicalDevice(bool enableValidationLayers, const std::vector<const char *> &deviceExtensions, const std::vector<const char *> &validationLayers, VkQueue *presentQueue, VkQueue *graphicsQueue)
+void DeviceManager::createLogicalDevice(bool enableValidationLayers, const std::vector<const char *> &deviceExtensions, const std::vector<const char *> &validationLayers, VkQueue *presentQueue, VkQueue *graphicsQueue, VkQueue *transferQueue)
 {
   QueueFamilyIndices indices = findQueueFamilies(physicalDevice, swapchainManager.surface);
+  queueFamilies = indices;
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+  if (indices.transferFamily.has_value())
+  {
+    uniqueQueueFamilies.insert(indices.transferFamily.value());
+  }
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -29,11 +35,44 @@ void DeviceManager::createLogicalDevice(bool enableValidationLayers, const std::
 
   queueCreateInfo.pQueuePriorities = &queuePriority;
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+
   VkPhysicalDeviceFeatures deviceFeatures{};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  deviceFeatures.textureCompressionBC = textureCompressionBC ? VK_TRUE : VK_FALSE;
+
+  // timeline semaphores let texture uploads on the transfer queue be polled without a fence per upload
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  VkPhysicalDeviceVulkan12Features vulkan12Features{};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  if (properties.apiVersion >= VK_API_VERSION_1_2)
+  {
+    VkPhysicalDeviceFeatures2 supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+  }
+  timelineSemaphores = vulkan12Features.timelineSemaphore == VK_TRUE;
+
+  VkPhysicalDeviceVulkan12Features enabled12Features{};
+  enabled12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  enabled12Features.timelineSemaphore = timelineSemaphores ? VK_TRUE : VK_FALSE;
+  // the bindless texture array, isDeviceSuitable already checked for these
+  enabled12Features.descriptorIndexing = VK_TRUE;
+  enabled12Features.runtimeDescriptorArray = VK_TRUE;
+  enabled12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  enabled12Features.descriptorBindingPartiallyBound = VK_TRUE;
+  enabled12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
 
   VkDeviceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  if (properties.apiVersion >= VK_API_VERSION_1_2)
+  {
+    createInfo.pNext = &enabled12Features;
+  }
 
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -60,6 +99,11 @@ void DeviceManager::createLogicalDevice(bool enableValidationLayers, const std::
 
   vkGetDeviceQueue(device, indices.presentFamily.value(), 0, presentQueue);
   vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, graphicsQueue);
+  *transferQueue = VK_NULL_HANDLE;
+  if (indices.transferFamily.has_value())
+  {
+    vkGetDeviceQueue(device, indices.transferFamily.value(), 0, transferQueue);
+  }
 }
 
 void DeviceManager::pickPhysicalDevice(VkInstance instance, const std::vector<const char *> &deviceExtensions)
@@ -107,7 +151,7 @@ bool DeviceManager::isDeviceSuitable(VkPhysicalDevice device, const std::vector<
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-  return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+  return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy && supportsBindlessTextures(device);
 
   // another example
   /*
@@ -122,6 +166,35 @@ bool DeviceManager::isDeviceSuitable(VkPhysicalDevice device, const std::vector<
   */
 }
 
+bool DeviceManager::supportsBindlessTextures(VkPhysicalDevice device)
+{
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(device, &properties);
+  if (properties.apiVersion < VK_API_VERSION_1_2)
+  {
+    return false;
+  }
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features{};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 supported{};
+  supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  supported.pNext = &vulkan12Features;
+  vkGetPhysicalDeviceFeatures2(device, &supported);
+
+  VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+  vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+  VkPhysicalDeviceProperties2 limits{};
+  limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  limits.pNext = &vulkan12Properties;
+  vkGetPhysicalDeviceProperties2(device, &limits);
+
+  return vulkan12Features.descriptorIndexing && vulkan12Features.runtimeDescriptorArray && vulkan12Features.shaderSampledImageArrayNonUniformIndexing &&
+         vulkan12Features.descriptorBindingPartiallyBound && vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+         vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers >= MAX_BINDLESS_TEXTURES &&
+         vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages >= MAX_BINDLESS_TEXTURES;
+}
+
 bool DeviceManager::checkDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char *> &deviceExtensions)
 {
   uint32_t extensionCount;
@@ -1,6 +1,7 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <vector>
+#include "utils.h"
 class SwapchainManager;
 class DeviceManager
 {
@@ -8,6 +9,9 @@ public:
   VkDevice device;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   SwapchainManager &swapchainManager;
+  QueueFamilyIndices queueFamilies;    // of the picked device, filled by createLogicalDevice
+  bool timelineSemaphores = false;     // Vulkan 1.2 core feature, enabled when the device has it
+  bool textureCompressionBC = false;   // enabled when the device has it, baked .ktx2 textures are only used then
   DeviceManager(SwapchainManager &swapchainManager) : swapchainManager(swapchainManager)
   {
   }
@@ -15,10 +19,11 @@ public:
   {
   }
 
-  void createLogicalDevice(bool enableValidationLayers, const std::vector<const char *> &deviceExtensions, const std::vector<const char *> &validationLayers, VkQueue *presentQueue, VkQueue *graphicsQueue);
+  void createLogicalDevice(bool enableValidationLayers, const std::vector<const char *> &deviceExtensions, const std::vector<const char *> &validationLayers, VkQueue *presentQueue, VkQueue *graphicsQueue, VkQueue *transferQueue);
   void pickPhysicalDevice(VkInstance instance, const std::vector<const char *> &deviceExtensions);
 
 private:
   bool isDeviceSuitable(VkPhysicalDevice device, const std::vector<const char *> &deviceExtensions);
+  bool supportsBindlessTextures(VkPhysicalDevice device); // Vulkan 1.2 descriptor indexing for MAX_BINDLESS_TEXTURES samplers
   bool checkDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char *> &deviceExtensions);
 };
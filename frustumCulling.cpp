@@ -0,0 +1,172 @@
+#include "frustumCulling.hpp"
+#include "vertex.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+BoundingVolume computeBoundingVolume(const std::vector<Vertex> &vertices)
+{
+  BoundingVolume bounds;
+  if (vertices.empty())
+  {
+    return bounds;
+  }
+
+  bounds.aabbMin = glm::vec3(std::numeric_limits<float>::max());
+  bounds.aabbMax = glm::vec3(std::numeric_limits<float>::lowest());
+  for (const Vertex &vertex : vertices)
+  {
+    bounds.aabbMin = glm::min(bounds.aabbMin, vertex.pos);
+    bounds.aabbMax = glm::max(bounds.aabbMax, vertex.pos);
+  }
+
+  // centred on the box, the radius reaches the farthest vertex which is usually tighter than the half diagonal
+  bounds.sphereCenter = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+  float radius2 = 0.0f;
+  for (const Vertex &vertex : vertices)
+  {
+    glm::vec3 offset = vertex.pos - bounds.sphereCenter;
+    radius2 = std::max(radius2, glm::dot(offset, offset));
+  }
+  bounds.sphereRadius = std::sqrt(radius2);
+  bounds.valid = true;
+  return bounds;
+}
+
+void Frustum::extract(const glm::mat4 &viewProjection)
+{
+  // glm is column major, row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+  auto row = [&](int i)
+  { return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); };
+
+  // near uses the -w..w depth range, that is also a conservative bound for 0..1 projections
+  glm::vec4 planes[6] = {
+      row(3) + row(0), // left
+      row(3) - row(0), // right
+      row(3) + row(1), // bottom
+      row(3) - row(1), // top
+      row(3) + row(2), // near
+      row(3) - row(2)  // far
+  };
+
+  for (int i = 0; i < 6; i++)
+  {
+    float length = glm::length(glm::vec3(planes[i]));
+    normalX[i] = planes[i].x / length;
+    normalY[i] = planes[i].y / length;
+    normalZ[i] = planes[i].z / length;
+    distance[i] = planes[i].w / length;
+  }
+  for (int i = 6; i < 8; i++)
+  {
+    normalX[i] = 0.0f;
+    normalY[i] = 0.0f;
+    normalZ[i] = 0.0f;
+    distance[i] = std::numeric_limits<float>::max();
+  }
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const
+{
+#ifdef FRUSTUM_USE_SSE
+  __m128 cx = _mm_set1_ps(center.x);
+  __m128 cy = _mm_set1_ps(center.y);
+  __m128 cz = _mm_set1_ps(center.z);
+  __m128 negRadius = _mm_set1_ps(-radius);
+  for (int i = 0; i < 8; i += 4)
+  {
+    __m128 signedDistance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_load_ps(normalX + i), cx), _mm_mul_ps(_mm_load_ps(normalY + i), cy)),
+        _mm_add_ps(_mm_mul_ps(_mm_load_ps(normalZ + i), cz), _mm_load_ps(distance + i)));
+    if (_mm_movemask_ps(_mm_cmplt_ps(signedDistance, negRadius)) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+#else
+  for (int i = 0; i < 6; i++)
+  {
+    float signedDistance = normalX[i] * center.x + normalY[i] * center.y + normalZ[i] * center.z + distance[i];
+    if (signedDistance < -radius)
+    {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+bool Frustum::intersectsAabb(const glm::vec3 &center, const glm::vec3 &extent) const
+{
+#ifdef FRUSTUM_USE_SSE
+  __m128 cx = _mm_set1_ps(center.x);
+  __m128 cy = _mm_set1_ps(center.y);
+  __m128 cz = _mm_set1_ps(center.z);
+  __m128 ex = _mm_set1_ps(extent.x);
+  __m128 ey = _mm_set1_ps(extent.y);
+  __m128 ez = _mm_set1_ps(extent.z);
+  __m128 signBit = _mm_set1_ps(-0.0f);
+  __m128 zero = _mm_setzero_ps();
+  for (int i = 0; i < 8; i += 4)
+  {
+    __m128 nx = _mm_load_ps(normalX + i);
+    __m128 ny = _mm_load_ps(normalY + i);
+    __m128 nz = _mm_load_ps(normalZ + i);
+    __m128 signedDistance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+        _mm_add_ps(_mm_mul_ps(nz, cz), _mm_load_ps(distance + i)));
+    // projected half size of the box onto the plane normal
+    __m128 projectedExtent = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signBit, nx), ex), _mm_mul_ps(_mm_andnot_ps(signBit, ny), ey)),
+        _mm_mul_ps(_mm_andnot_ps(signBit, nz), ez));
+    if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(signedDistance, projectedExtent), zero)) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+#else
+  for (int i = 0; i < 6; i++)
+  {
+    float signedDistance = normalX[i] * center.x + normalY[i] * center.y + normalZ[i] * center.z + distance[i];
+    float projectedExtent = std::abs(normalX[i]) * extent.x + std::abs(normalY[i]) * extent.y + std::abs(normalZ[i]) * extent.z;
+    if (signedDistance + projectedExtent < 0.0f)
+    {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+bool isVisible(const Frustum &frustum, const BoundingVolume &bounds, const glm::mat4 &model)
+{
+  if (!bounds.valid)
+  {
+    return true;
+  }
+
+  float maxScale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+  glm::vec3 sphereCenter = glm::vec3(model * glm::vec4(bounds.sphereCenter, 1.0f));
+  if (!frustum.intersectsSphere(sphereCenter, bounds.sphereRadius * maxScale))
+  {
+    return false;
+  }
+
+  // world aligned box around the rotated local box
+  glm::vec3 localCenter = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+  glm::vec3 localExtent = (bounds.aabbMax - bounds.aabbMin) * 0.5f;
+  glm::vec3 worldCenter = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+  glm::vec3 worldExtent;
+  for (int i = 0; i < 3; i++)
+  {
+    worldExtent[i] = std::abs(model[0][i]) * localExtent.x + std::abs(model[1][i]) * localExtent.y + std::abs(model[2][i]) * localExtent.z;
+  }
+  return frustum.intersectsAabb(worldCenter, worldExtent);
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+struct Vertex;
+
+// Local-space bounds of a mesh, computed once from its vertices
+struct BoundingVolume
+{
+  glm::vec3 aabbMin = glm::vec3(0);
+  glm::vec3 aabbMax = glm::vec3(0);
+  glm::vec3 sphereCenter = glm::vec3(0);
+  float sphereRadius = 0.0f;
+  bool valid = false; // false for meshes without vertices, those are never culled
+};
+
+BoundingVolume computeBoundingVolume(const std::vector<Vertex> &vertices);
+
+// The six clip planes of a view-projection matrix, laid out so four planes are tested per SSE instruction.
+// Lanes 6 and 7 are padding planes that accept everything.
+struct Frustum
+{
+  alignas(16) float normalX[8];
+  alignas(16) float normalY[8];
+  alignas(16) float normalZ[8];
+  alignas(16) float distance[8];
+
+  void extract(const glm::mat4 &viewProjection);
+  bool intersectsSphere(const glm::vec3 &center, float radius) const;
+  bool intersectsAabb(const glm::vec3 &center, const glm::vec3 &extent) const;
+};
+
+// Moves the local bounds by the model matrix, tests the sphere first and the tighter box after it
+bool isVisible(const Frustum &frustum, const BoundingVolume &bounds, const glm::mat4 &model);
+
+struct CullingStats
+{
+  int visible = 0;
+  int total = 0;
+  int drawCalls = 0;
+  double cullMs = 0.0;   // transforms, frustum tests and batching
+  double recordMs = 0.0; // the whole command buffer, culling included
+  int recordSlices = 0;  // secondary buffers the draws were recorded into
+};
\ No newline at end of file
@@ -1,30 +1,165 @@
 #include "gameObject.hpp"
 #include "bufferManager.hpp"
 #include "descriptorManager.hpp"
-#include "textureManager.hpp"
 #include "renderer.hpp"
 #include <vulkan/vulkan.h>
 #include <tiny_obj_loader.h>
 #include <glm/gtc/quaternion.hpp>
 #include "gameObjectPhysicsConfig.hpp"
+#include "characterController.hpp"
+#include "kinematicMotionState.hpp"
+#include "meshOptimizer.hpp"
+#include <BulletCollision/CollisionShapes/btShapeHull.h>
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+#include <fstream>
+#include <filesystem>
+#include <cmath>
+
+#define CONVEX_HULL_CACHE_MAGIC 0x4C4C5548 // "HULL"
+#define CONVEX_HULL_CACHE_VERSION 2
+
+// size and modification time of the model a hull cache was built from, false if it can't be read
+static bool modelFileStamp(const std::string &path, uint64_t stamp[2])
+{
+  std::error_code error;
+  stamp[0] = std::filesystem::file_size(path, error);
+  if (error)
+  {
+    return false;
+  }
+  stamp[1] = static_cast<uint64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+  return !error;
+}
+
+static void deleteCollisionShape(btCollisionShape *shape)
+{
+  if (shape->isCompound())
+  {
+    btCompoundShape *compoundShape = static_cast<btCompoundShape *>(shape);
+    for (int i = compoundShape->getNumChildShapes() - 1; i >= 0; i--)
+    {
+      btCollisionShape *childShape = compoundShape->getChildShape(i);
+      compoundShape->removeChildShapeByIndex(i);
+      deleteCollisionShape(childShape);
+    }
+  }
+  else if (shape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
+  {
+    delete static_cast<btBvhTriangleMeshShape *>(shape)->getMeshInterface();
+  }
+
+  delete shape;
+}
+
+static int defaultCollisionGroup(const PhysicsConfig &config)
+{
+  if (config.isTrigger)
+    return TriggerGroup;
+  if (config.isCharacter)
+    return PlayerGroup;
+  if (config.isKinematic)
+    return RemotePlayerGroup;
+  if (!config.isRigidBody || !config.canMove || config.mass == 0)
+    return StaticWorldGroup;
+  return DynamicPropGroup;
+}
+
+static int defaultCollisionMask(int group)
+{
+  switch (group)
+  {
+  case StaticWorldGroup:
+    return DynamicPropGroup | PlayerGroup | RemotePlayerGroup;
+  case DynamicPropGroup:
+    return StaticWorldGroup | DynamicPropGroup | PlayerGroup | RemotePlayerGroup;
+  case PlayerGroup:
+    return StaticWorldGroup | DynamicPropGroup | RemotePlayerGroup | TriggerGroup;
+  case RemotePlayerGroup:
+    return StaticWorldGroup | DynamicPropGroup | PlayerGroup;
+  case TriggerGroup:
+    return PlayerGroup; // powerups only care about the local player
+  default:
+    return AllGroups;
+  }
+}
 
-GameObject::GameObject(Renderer &renderer, int id, PhysicsConfig &config, const glm::vec3 &pos, const glm::vec3 &scale, const glm::vec3 &rotationZYX, std::vector<Vertex> vertices, std::vector<uint32_t> indices, GameObjectTags tag) : id(id), config(config), pos(pos), scale(scale), rotationZYX(rotationZYX), vertices(vertices), indices(indices), textureManager(renderer.bufferManager, renderer), tag(tag)
+GameObject::GameObject(Renderer &renderer, int id, PhysicsConfig &config, const glm::vec3 &pos, const glm::vec3 &scale, const glm::vec3 &rotationZYX, std::vector<Vertex> vertices, std::vector<uint32_t> indices, GameObjectTags tag) : id(id), config(config), pos(pos), physicsPos(pos), scale(scale), rotationZYX(rotationZYX), vertices(vertices), indices(indices), tag(tag)
 {
+  localBounds = computeBoundingVolume(this->vertices);
 }
 
 void GameObject::initGraphics(Renderer &renderer, std::string texturePath)
 {
-  textureManager.createTextureImage(texturePath, renderer.deviceManager.device, renderer.deviceManager.physicalDevice, renderer.commandPool, renderer.graphicsQueue);
-  textureManager.createTextureImageView(renderer.deviceManager.device);
-  textureManager.createTextureSampler(renderer.deviceManager.device, renderer.deviceManager.physicalDevice);
+  texture = renderer.textureRegistry.acquire(texturePath, renderer.deviceManager.device);
 
-  renderer.bufferManager.createVertexBuffer(vertices, id, renderer.deviceManager.device, renderer.deviceManager.physicalDevice, renderer.commandPool, renderer.graphicsQueue);
+  std::string meshKey = modelPath.empty() ? MeshRegistry::contentKey(vertices, indices) : modelPath;
+  mesh = renderer.meshRegistry.acquire(meshKey, vertices, indices, renderer.deviceManager.device, renderer.deviceManager.physicalDevice, renderer.commandPool, renderer.graphicsQueue);
 
-  renderer.bufferManager.createIndexBuffer(indices, id, renderer.deviceManager.device, renderer.deviceManager.physicalDevice, renderer.commandPool, renderer.graphicsQueue);
+  // hulls keep their own unscaled points, objects built from inline vertices get theirs here before the mesh goes
+  if ((config.collider == ColliderType::ConvexHull || config.collider == ColliderType::ConvexDecomposition) && convexHulls.empty())
+  {
+    buildConvexHulls();
+  }
 
-  renderer.bufferManager.createUniformBuffers(renderer.MAX_FRAMES_IN_FLIGHT, renderer.deviceManager.device, renderer.deviceManager.physicalDevice, 1);
+  // box, character, trigger and hull shapes don't need the mesh, triangle meshes are rebuilt from it on setScale
+  if (!needsCpuMesh())
+  {
+    std::vector<Vertex>().swap(vertices);
+    std::vector<uint32_t>().swap(indices);
+  }
+}
 
-  renderer.descriptorManager.addDescriptorSets(renderer.deviceManager.device, renderer.MAX_FRAMES_IN_FLIGHT, 1, textureManager);
+void GameObject::cleanupGraphics(Renderer &renderer)
+{
+  renderer.textureRegistry.release(texture, renderer.deviceManager.device);
+  renderer.textureRegistry.release(pendingTexture, renderer.deviceManager.device);
+  texture = INVALID_TEXTURE;
+  pendingTexture = INVALID_TEXTURE;
+  renderer.meshRegistry.release(mesh, renderer.deviceManager.device);
+  mesh = INVALID_MESH;
+}
+
+void GameObject::setTexture(Renderer &renderer, TextureHandle handle)
+{
+  TextureRegistry &registry = renderer.textureRegistry;
+  VkDevice device = renderer.deviceManager.device;
+
+  // a swap still waiting on its upload is superseded
+  registry.release(pendingTexture, device);
+  pendingTexture = handle;
+  applyPendingTexture(renderer);
+}
+
+void GameObject::applyPendingTexture(Renderer &renderer)
+{
+  if (pendingTexture == INVALID_TEXTURE)
+  {
+    return;
+  }
+
+  TextureRegistry &registry = renderer.textureRegistry;
+  const CachedTexture &cached = registry.get(pendingTexture);
+  if (cached.ready)
+  {
+    registry.release(texture, renderer.deviceManager.device);
+    texture = pendingTexture;
+    pendingTexture = INVALID_TEXTURE;
+  }
+  else if (cached.failed)
+  {
+    registry.release(pendingTexture, renderer.deviceManager.device);
+    pendingTexture = INVALID_TEXTURE;
+  }
+}
+
+bool GameObject::needsCpuMesh() const
+{
+  return config.collider == ColliderType::Mesh;
+}
+
+glm::vec3 GameObject::scaledLocalSize() const
+{
+  return glm::abs((localBounds.aabbMax - localBounds.aabbMin) * scale);
 }
 
 /*
@@ -40,7 +175,7 @@ GameObject::GameObject(BufferManager &bufferManager, DescriptorManager &descript
 }
 */
 
-void GameObject::draw(Renderer *renderer, int currentFrame, glm::mat4 view, glm::mat4 projectionMatrix, VkCommandBuffer commandBuffer)
+glm::mat4 GameObject::getModelMatrix() const
 {
   glm::mat4 transformation = glm::mat4(1.0f);
   transformation = glm::translate(transformation, pos);
@@ -48,24 +183,28 @@ void GameObject::draw(Renderer *renderer, int currentFrame, glm::mat4 view, glm:
   transformation = glm::rotate(transformation, glm::radians(rotationZYX.y), glm::vec3(0.0f, 1.0f, 0.0f));
   transformation = glm::rotate(transformation, glm::radians(rotationZYX.z), glm::vec3(1.0f, 0.0f, 0.0f));
   transformation = glm::scale(transformation, scale);
+  return transformation;
+}
+
+void GameObject::draw(Renderer *renderer, VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
+{
+  const GpuMesh &gpuMesh = renderer->meshRegistry.get(mesh);
 
-  VkBuffer vertexBuffersArray[] = {renderer->bufferManager.vertexBuffers[id]};
+  VkBuffer vertexBuffersArray[] = {gpuMesh.vertexBuffer};
   VkDeviceSize offsets[] = {0};
   vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffersArray, offsets);
 
-  vkCmdBindIndexBuffer(commandBuffer, renderer->bufferManager.indexBuffers[id], 0, VK_INDEX_TYPE_UINT32);
+  vkCmdBindIndexBuffer(commandBuffer, gpuMesh.indexBuffer, 0, gpuMesh.indexType);
 
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->pipelineManager.pipelineLayout, 0, 1, &renderer->descriptorManager.descriptorSets[currentFrame + id * renderer->MAX_FRAMES_IN_FLIGHT], 0, nullptr);
-
-  renderer->bufferManager.updateUniformBuffer(currentFrame + id * renderer->MAX_FRAMES_IN_FLIGHT, transformation, view, projectionMatrix);
-
-  vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+  vkCmdDrawIndexed(commandBuffer, gpuMesh.indexCount, instanceCount, 0, 0, firstInstance);
 }
 
-void GameObject::loadModel(const std::string MODEL_PATH)
+MeshOptimizationStats GameObject::loadModel(const std::string MODEL_PATH)
 {
   vertices.clear();
   indices.clear();
+  shapeIndexOffsets.clear();
+  modelPath = MODEL_PATH;
 
   tinyobj::attrib_t attrib;
   std::vector<tinyobj::shape_t> shapes;
@@ -86,6 +225,7 @@ void GameObject::loadModel(const std::string MODEL_PATH)
 
   for (const auto &shape : shapes)
   {
+    shapeIndexOffsets.push_back(indices.size());
     for (const auto &index : shape.mesh.indices)
     {
       Vertex vertex{};
@@ -105,29 +245,243 @@ void GameObject::loadModel(const std::string MODEL_PATH)
       indices.push_back(indices.size());
     }
   }
+
+  MeshOptimizationStats stats;
+  stats.sourceVertices = vertices.size();
+  stats.triangles = indices.size() / 3;
+  stats.acmrSource = computeAcmr(indices, vertices.size());
+
+  weldVertices(vertices, indices);
+  stats.uniqueVertices = vertices.size();
+  stats.acmrWelded = computeAcmr(indices, vertices.size());
+
+  // triangles are only reordered inside each shape so shapeIndexOffsets still marks the decomposition parts
+  for (size_t shape = 0; shape < shapeIndexOffsets.size(); shape++)
+  {
+    size_t shapeEnd = shape + 1 < shapeIndexOffsets.size() ? shapeIndexOffsets[shape + 1] : indices.size();
+    optimizeVertexCache(indices, shapeIndexOffsets[shape], shapeEnd, vertices.size());
+  }
+  optimizeVertexFetch(vertices, indices);
+  stats.acmrOptimized = computeAcmr(indices, vertices.size());
+
+  localBounds = computeBoundingVolume(vertices);
+
+  if (config.collider == ColliderType::ConvexHull || config.collider == ColliderType::ConvexDecomposition)
+  {
+    buildConvexHulls();
+  }
+  return stats;
 }
 
-void GameObject::initPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
+void GameObject::buildConvexHulls()
 {
-  if (config.collider == ColliderType::None)
+  convexHulls.clear();
+
+  std::string cachePath = modelPath + (config.collider == ColliderType::ConvexDecomposition ? ".decomposition.hull" : ".hull");
+  if (!modelPath.empty() && loadConvexHullCache(cachePath))
   {
     return;
   }
 
-  if (config.collider == ColliderType::Box && config.boxColliderSize == glm::vec3(-1))
+  // ConvexHull wraps the whole model, ConvexDecomposition gets one hull per OBJ shape
+  std::vector<size_t> partOffsets = {0};
+  if (config.collider == ColliderType::ConvexDecomposition && !shapeIndexOffsets.empty())
   {
+    partOffsets = shapeIndexOffsets;
+  }
+  partOffsets.push_back(indices.size());
 
-    glm::vec3 minCorner(std::numeric_limits<float>::max());
-    glm::vec3 maxCorner(std::numeric_limits<float>::lowest());
+  for (size_t part = 0; part + 1 < partOffsets.size(); part++)
+  {
+    btAlignedObjectArray<btVector3> points;
+    for (size_t i = partOffsets[part]; i < partOffsets[part + 1]; i++)
+    {
+      const glm::vec3 &position = vertices[indices[i]].pos;
+      points.push_back(btVector3(position.x, position.y, position.z));
+    }
 
-    for (const auto &vertex : vertices)
+    if (points.size() < 4)
+    {
+      continue;
+    }
+
+    btConvexHullShape pointCloud(&points[0].getX(), points.size(), sizeof(btVector3));
+    btShapeHull shapeHull(&pointCloud);
+    shapeHull.buildHull(0);
+
+    const btVector3 *hullVertices = shapeHull.getVertexPointer();
+    int hullVertexCount = shapeHull.numVertices();
+
+    std::vector<glm::vec3> hull;
+    if (hullVertexCount <= config.convexHullMaxVertices)
+    {
+      for (int i = 0; i < hullVertexCount; i++)
+      {
+        hull.push_back(glm::vec3(hullVertices[i].getX(), hullVertices[i].getY(), hullVertices[i].getZ()));
+      }
+    }
+    else
+    {
+      // over budget, keep the support points along evenly spread (fibonacci sphere) directions
+      const float goldenAngle = 2.39996323f;
+      std::vector<bool> used(hullVertexCount, false);
+      for (int d = 0; d < config.convexHullMaxVertices; d++)
+      {
+        float y = 1.0f - 2.0f * (d + 0.5f) / config.convexHullMaxVertices;
+        float radius = std::sqrt(1.0f - y * y);
+        btVector3 direction(std::cos(goldenAngle * d) * radius, y, std::sin(goldenAngle * d) * radius);
+
+        int support = 0;
+        for (int i = 1; i < hullVertexCount; i++)
+        {
+          if (hullVertices[i].dot(direction) > hullVertices[support].dot(direction))
+          {
+            support = i;
+          }
+        }
+
+        if (!used[support])
+        {
+          used[support] = true;
+          hull.push_back(glm::vec3(hullVertices[support].getX(), hullVertices[support].getY(), hullVertices[support].getZ()));
+        }
+      }
+    }
+
+    convexHulls.push_back(hull);
+  }
+
+  if (!modelPath.empty())
+  {
+    saveConvexHullCache(cachePath);
+  }
+}
+
+bool GameObject::loadConvexHullCache(const std::string &cachePath)
+{
+  std::ifstream file(cachePath, std::ios::binary);
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  uint32_t header[6];
+  uint64_t cachedStamp[2];
+  file.read(reinterpret_cast<char *>(header), sizeof(header));
+  file.read(reinterpret_cast<char *>(cachedStamp), sizeof(cachedStamp));
+  if (!file || header[0] != CONVEX_HULL_CACHE_MAGIC || header[1] != CONVEX_HULL_CACHE_VERSION || header[2] != static_cast<uint32_t>(config.collider) || header[3] != static_cast<uint32_t>(config.convexHullMaxVertices) || header[4] != static_cast<uint32_t>(indices.size()))
+  {
+    return false;
+  }
+
+  // an edited model can keep its index count, so the hulls are only trusted for the exact file they came from
+  uint64_t stamp[2];
+  if (!modelFileStamp(modelPath, stamp) || stamp[0] != cachedStamp[0] || stamp[1] != cachedStamp[1])
+  {
+    return false;
+  }
+
+  std::vector<std::vector<glm::vec3>> cachedHulls(header[5]);
+  for (auto &hull : cachedHulls)
+  {
+    uint32_t pointCount = 0;
+    file.read(reinterpret_cast<char *>(&pointCount), sizeof(pointCount));
+    hull.resize(pointCount);
+    file.read(reinterpret_cast<char *>(hull.data()), pointCount * sizeof(glm::vec3));
+  }
+
+  if (!file)
+  {
+    return false;
+  }
+
+  convexHulls = cachedHulls;
+  return true;
+}
+
+void GameObject::saveConvexHullCache(const std::string &cachePath)
+{
+  std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    std::cerr << "Failed to write convex hull cache: " << cachePath << std::endl;
+    return;
+  }
+
+  uint32_t header[6] = {CONVEX_HULL_CACHE_MAGIC, CONVEX_HULL_CACHE_VERSION, static_cast<uint32_t>(config.collider), static_cast<uint32_t>(config.convexHullMaxVertices), static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(convexHulls.size())};
+  uint64_t stamp[2] = {0, 0};
+  modelFileStamp(modelPath, stamp);
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(stamp), sizeof(stamp));
+
+  for (const auto &hull : convexHulls)
+  {
+    uint32_t pointCount = static_cast<uint32_t>(hull.size());
+    file.write(reinterpret_cast<const char *>(&pointCount), sizeof(pointCount));
+    file.write(reinterpret_cast<const char *>(hull.data()), pointCount * sizeof(glm::vec3));
+  }
+}
+
+btCollisionShape *GameObject::createConvexHullShape()
+{
+  if (convexHulls.empty())
+  {
+    buildConvexHulls();
+  }
+
+  std::vector<btConvexHullShape *> hullShapes;
+  for (const auto &hull : convexHulls)
+  {
+    btConvexHullShape *hullShape = new btConvexHullShape();
+    for (const auto &point : hull)
     {
-      glm::vec3 scaledVertex = vertex.pos * scale;
-      minCorner = glm::min(minCorner, scaledVertex);
-      maxCorner = glm::max(maxCorner, scaledVertex);
+      glm::vec3 scaledPoint = point * scale;
+      hullShape->addPoint(btVector3(scaledPoint.x, scaledPoint.y, scaledPoint.z), false);
     }
+    hullShape->recalcLocalAabb();
+    hullShape->setMargin(config.meshColliderMargin);
+    hullShapes.push_back(hullShape);
+  }
+
+  if (config.collider == ColliderType::ConvexHull && hullShapes.size() == 1)
+  {
+    return hullShapes[0];
+  }
+
+  btCompoundShape *compoundShape = new btCompoundShape();
+  btTransform localTransform;
+  localTransform.setIdentity();
+  for (btConvexHullShape *hullShape : hullShapes)
+  {
+    compoundShape->addChildShape(localTransform, hullShape);
+  }
 
-    glm::vec3 size = maxCorner - minCorner;
+  return compoundShape;
+}
+
+void GameObject::initPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
+{
+  physicsPos = pos;
+  if (config.collider == ColliderType::None)
+  {
+    return;
+  }
+
+  int collisionGroup = getCollisionGroup();
+  int collisionMask = config.collisionMask != 0 ? config.collisionMask : defaultCollisionMask(collisionGroup);
+
+  if (config.isCharacter)
+  {
+    glm::vec3 size = scaledLocalSize();
+
+    characterController = new CharacterController(dynamicsWorld, btVector3(pos.x, pos.y, pos.z), 0.5f * std::max(size.x, size.z), size.y, (void *)this, collisionGroup, collisionMask);
+    characterController->collisionObject->setUserIndex(id);
+    return;
+  }
+
+  if (config.collider == ColliderType::Box && config.boxColliderSize == glm::vec3(-1))
+  {
+    glm::vec3 size = scaledLocalSize();
 
     collisionShape = new btBoxShape(btVector3(size.x * 0.5f, size.y * 0.5f, size.z * 0.5f));
   }
@@ -152,6 +506,10 @@ void GameObject::initPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
     collisionShape = compoundShape;
     collisionShape->setMargin(config.meshColliderMargin);
   }
+  else if (config.collider == ColliderType::ConvexHull || config.collider == ColliderType::ConvexDecomposition)
+  {
+    collisionShape = createConvexHullShape();
+  }
   else
   {
     collisionShape = new btBoxShape(btVector3(config.boxColliderSize.x, config.boxColliderSize.y, config.boxColliderSize.z));
@@ -162,17 +520,18 @@ void GameObject::initPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
     btTransform transform;
     transform.setIdentity();
     transform.setOrigin(btVector3(pos.x, pos.y, pos.z));
-    collisionObject = new btCollisionObject();
+    collisionObject = config.isTrigger ? new btGhostObject() : new btCollisionObject();
     collisionObject->setCollisionShape(collisionShape);
+    collisionObject->setUserIndex(id);
 
-    if (config.interactable == false)
+    if (config.interactable == false || config.isTrigger)
     {
       collisionObject->setCollisionFlags(btCollisionObject::CF_NO_CONTACT_RESPONSE);
     }
 
     collisionObject->setWorldTransform(transform);
 
-    dynamicsWorld->addCollisionObject(collisionObject);
+    dynamicsWorld->addCollisionObject(collisionObject, collisionGroup, collisionMask);
     return;
   }
 
@@ -180,13 +539,22 @@ void GameObject::initPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
   initialTransform.setIdentity();
   initialTransform.setOrigin(btVector3(pos.x, pos.y, pos.z));
   initialTransform.setRotation(btQuaternion(glm::radians(rotationZYX.z), glm::radians(rotationZYX.y), glm::radians(rotationZYX.x)));
-  motionState = new btDefaultMotionState(initialTransform);
+  if (config.isKinematic)
+  {
+    motionState = new KinematicMotionState(initialTransform);
+  }
+  else
+  {
+    motionState = new btDefaultMotionState(initialTransform);
+  }
 
   btVector3 inertia(0, 0, 0);
   collisionShape->calculateLocalInertia(config.mass, inertia);
 
   btRigidBody::btRigidBodyConstructionInfo rigidBodyCI(config.mass, motionState, collisionShape, inertia);
   rigidBody = new btRigidBody(rigidBodyCI);
+  syncedFromPos = syncedToPos = pos;
+  syncedFromRotation = syncedToRotation = initialTransform.getRotation();
 
   int flags = rigidBody->getFlags();
   if (!config.canMove)
@@ -215,6 +583,14 @@ void GameObject::initPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
     rigidBody->setCollisionFlags(btCollisionObject::CF_NO_CONTACT_RESPONSE);
   }
 
+  if (config.isKinematic)
+  {
+    // Bullet pulls the transform from the motion state every step, so the body never needs waking
+    rigidBody->setMassProps(0, btVector3(0, 0, 0));
+    rigidBody->setCollisionFlags(rigidBody->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+    rigidBody->setActivationState(DISABLE_DEACTIVATION);
+  }
+
   rigidBody->setGravity(btVector3(0, -20.f, 0));
 
   rigidBody->setFriction(config.friction);
@@ -224,10 +600,11 @@ void GameObject::initPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
   rigidBody->setRestitution(config.restitution);
 
   rigidBody->setUserPointer((void *)this);
+  rigidBody->setUserIndex(id);
 
   rigidBody->activate();
 
-  dynamicsWorld->addRigidBody(rigidBody);
+  dynamicsWorld->addRigidBody(rigidBody, collisionGroup, collisionMask);
 }
 
 void GameObject::updatePhysics()
@@ -237,28 +614,35 @@ void GameObject::updatePhysics()
     return;
   }
 
-  if (rigidBody && rigidBody->getMotionState())
+  if (characterController)
+  {
+    pos.x = characterController->position.getX();
+    pos.y = characterController->position.getY();
+    pos.z = characterController->position.getZ();
+    physicsPos = pos;
+  }
+  else if (rigidBody && rigidBody->getMotionState())
   {
     btTransform transform;
     rigidBody->getMotionState()->getWorldTransform(transform);
+    physicsPos = glm::vec3(transform.getOrigin().getX(), transform.getOrigin().getY(), transform.getOrigin().getZ());
 
-    pos.x = transform.getOrigin().getX();
-    pos.y = transform.getOrigin().getY();
-    pos.z = transform.getOrigin().getZ();
-
-    if (config.canRotateX || config.canRotateY || config.canRotateZ)
+    // between syncs what is drawn moves from the previous synced transform to the latest one
+    if (physicsSyncInterval > 1 && ++stepsSinceSync < physicsSyncInterval)
     {
-      btQuaternion rotation = transform.getRotation();
-      btVector3 eulerAngles;
-      rotation.getEulerZYX(eulerAngles[0], eulerAngles[1], eulerAngles[2]);
-
-      if (config.canRotateZ)
-        rotationZYX.x = glm::degrees(eulerAngles[0]);
-      if (config.canRotateY)
-        rotationZYX.y = glm::degrees(eulerAngles[1]);
-      if (config.canRotateX)
-        rotationZYX.z = glm::degrees(eulerAngles[2]);
+      float blend = static_cast<float>(stepsSinceSync) / physicsSyncInterval;
+      pos = glm::mix(syncedFromPos, syncedToPos, blend);
+      showRotation(syncedFromRotation.slerp(syncedToRotation, blend));
+      return;
     }
+    stepsSinceSync = 0;
+
+    syncedFromPos = syncedToPos;
+    syncedToPos = physicsPos;
+    syncedFromRotation = syncedToRotation;
+    syncedToRotation = transform.getRotation();
+    pos = physicsSyncInterval > 1 ? syncedFromPos : syncedToPos;
+    showRotation(physicsSyncInterval > 1 ? syncedFromRotation : syncedToRotation);
   }
   else if (collisionObject)
   {
@@ -266,9 +650,91 @@ void GameObject::updatePhysics()
     pos.x = transform.getOrigin().getX();
     pos.y = transform.getOrigin().getY();
     pos.z = transform.getOrigin().getZ();
+    physicsPos = pos;
+  }
+}
+
+void GameObject::showRotation(const btQuaternion &rotation)
+{
+  if (config.canRotateX || config.canRotateY || config.canRotateZ)
+  {
+    btVector3 eulerAngles;
+    rotation.getEulerZYX(eulerAngles[0], eulerAngles[1], eulerAngles[2]);
+
+    if (config.canRotateZ)
+      rotationZYX.x = glm::degrees(eulerAngles[0]);
+    if (config.canRotateY)
+      rotationZYX.y = glm::degrees(eulerAngles[1]);
+    if (config.canRotateX)
+      rotationZYX.z = glm::degrees(eulerAngles[2]);
   }
 }
 
+int GameObject::getCollisionGroup() const
+{
+  return config.collisionGroup != 0 ? config.collisionGroup : defaultCollisionGroup(config);
+}
+
+bool GameObject::getWorldBounds(glm::vec3 &minCorner, glm::vec3 &maxCorner) const
+{
+  if (!localBounds.valid)
+  {
+    return false;
+  }
+
+  glm::mat4 transformation = getModelMatrix();
+
+  minCorner = glm::vec3(std::numeric_limits<float>::max());
+  maxCorner = glm::vec3(std::numeric_limits<float>::lowest());
+  auto addPoint = [&](const glm::vec3 &localPoint)
+  {
+    glm::vec3 worldPoint = glm::vec3(transformation * glm::vec4(localPoint, 1.0f));
+    minCorner = glm::min(minCorner, worldPoint);
+    maxCorner = glm::max(maxCorner, worldPoint);
+  };
+
+  // exact while the CPU mesh is around, otherwise the corners of the local box
+  if (!vertices.empty())
+  {
+    for (const auto &vertex : vertices)
+    {
+      addPoint(vertex.pos);
+    }
+    return true;
+  }
+
+  for (int corner = 0; corner < 8; corner++)
+  {
+    addPoint(glm::vec3(corner & 1 ? localBounds.aabbMax.x : localBounds.aabbMin.x,
+                       corner & 2 ? localBounds.aabbMax.y : localBounds.aabbMin.y,
+                       corner & 4 ? localBounds.aabbMax.z : localBounds.aabbMin.z));
+  }
+  return true;
+}
+
+void GameObject::updateKinematic(float deltaTime)
+{
+  if (rigidBody && config.isKinematic)
+  {
+    static_cast<KinematicMotionState *>(motionState)->advance(deltaTime);
+  }
+}
+
+void GameObject::setPhysicsSyncInterval(int interval)
+{
+  if (interval == physicsSyncInterval)
+  {
+    return;
+  }
+
+  // blending from a transform synced under the old interval would jump, so the next blend starts at the shown one
+  float blend = physicsSyncInterval > 1 ? static_cast<float>(stepsSinceSync) / physicsSyncInterval : 1.0f;
+  syncedFromRotation = syncedToRotation = syncedFromRotation.slerp(syncedToRotation, blend);
+  syncedFromPos = syncedToPos = pos;
+  physicsSyncInterval = interval;
+  stepsSinceSync = 0;
+}
+
 void GameObject::cleanupPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
 {
   if (config.collider == ColliderType::None)
@@ -276,6 +742,12 @@ void GameObject::cleanupPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
     return;
   }
 
+  if (characterController)
+  {
+    delete characterController;
+    characterController = nullptr;
+  }
+
   if (rigidBody)
   {
     dynamicsWorld->removeRigidBody(rigidBody);
@@ -298,32 +770,31 @@ void GameObject::cleanupPhysics(btDiscreteDynamicsWorld *dynamicsWorld)
 
   if (collisionShape)
   {
-    delete collisionShape;
+    deleteCollisionShape(collisionShape);
     collisionShape = nullptr;
   }
 }
 
-void GameObject::setScale(const glm::vec3 &newScale)
+bool GameObject::setScale(const glm::vec3 &newScale)
 {
+  glm::vec3 previousScale = scale;
   scale = newScale;
 
-  if (config.collider != ColliderType::None && collisionShape)
+  if (characterController)
+  {
+    if (!characterController->setHeight(scaledLocalSize().y))
+    {
+      scale = previousScale;
+      return false;
+    }
+  }
+  else if (config.collider != ColliderType::None && collisionShape)
   {
     if (config.collider == ColliderType::Box)
     {
-      glm::vec3 minCorner(std::numeric_limits<float>::max());
-      glm::vec3 maxCorner(std::numeric_limits<float>::lowest());
-
-      for (const auto &vertex : vertices)
-      {
-        glm::vec3 scaledVertex = vertex.pos * scale;
-        minCorner = glm::min(minCorner, scaledVertex);
-        maxCorner = glm::max(maxCorner, scaledVertex);
-      }
+      glm::vec3 size = scaledLocalSize();
 
-      glm::vec3 size = maxCorner - minCorner;
-
-      delete collisionShape;
+      deleteCollisionShape(collisionShape);
       collisionShape = new btBoxShape(btVector3(size.x * 0.5f, size.y * 0.5f, size.z * 0.5f));
 
       if (rigidBody)
@@ -347,9 +818,23 @@ void GameObject::setScale(const glm::vec3 &newScale)
         triangleMesh->addTriangle(btVector3(v0.x, v0.y, v0.z), btVector3(v1.x, v1.y, v1.z), btVector3(v2.x, v2.y, v2.z));
       }
 
-      delete collisionShape;
+      deleteCollisionShape(collisionShape);
       collisionShape = new btBvhTriangleMeshShape(triangleMesh, true);
 
+      if (rigidBody)
+      {
+        btVector3 inertia(0, 0, 0);
+        collisionShape->calculateLocalInertia(config.mass, inertia);
+        rigidBody->setCollisionShape(collisionShape);
+        rigidBody->setMassProps(config.mass, inertia);
+        rigidBody->activate();
+      }
+    }
+    else if (config.collider == ColliderType::ConvexHull || config.collider == ColliderType::ConvexDecomposition)
+    {
+      deleteCollisionShape(collisionShape);
+      collisionShape = createConvexHullShape();
+
       if (rigidBody)
       {
         btVector3 inertia(0, 0, 0);
@@ -360,13 +845,26 @@ void GameObject::setScale(const glm::vec3 &newScale)
       }
     }
   }
+  return true;
 }
 
 void GameObject::setPosition(const glm::vec3 &newPosition)
 {
   pos = newPosition;
+  physicsPos = newPosition;
 
-  if (rigidBody)
+  if (characterController)
+  {
+    characterController->warp(btVector3(pos.x, pos.y, pos.z));
+  }
+  else if (rigidBody && config.isKinematic)
+  {
+    btTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(btVector3(pos.x, pos.y, pos.z));
+    static_cast<KinematicMotionState *>(motionState)->setTarget(transform);
+  }
+  else if (rigidBody)
   {
     rigidBody->setActivationState(DISABLE_SIMULATION);
 
@@ -382,5 +880,10 @@ void GameObject::setPosition(const glm::vec3 &newPosition)
     }
 
     rigidBody->setActivationState(ACTIVE_TAG);
+
+    // a teleport is not blended towards
+    stepsSinceSync = 0;
+    syncedFromPos = syncedToPos = pos;
+    syncedFromRotation = syncedToRotation = transform.getRotation();
   }
 }
\ No newline at end of file
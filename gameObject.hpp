@@ -1,12 +1,17 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <string>
 #include "vertex.h"
 #include <btBulletDynamicsCommon.h>
-#include "textureManager.hpp"
+#include "textureRegistry.hpp"
+#include "physicsLod.hpp"
+#include "frustumCulling.hpp"
+#include "meshRegistry.hpp"
+#include "meshOptimizer.hpp"
 
 class Renderer;
-class TextureManager;
+class CharacterController;
 struct PhysicsConfig;
 
 enum class GameObjectTags
@@ -22,7 +27,8 @@ enum class GameObjectTags
 class GameObject
 {
 public:
-  glm::vec3 pos;
+  glm::vec3 pos;         // where the object is drawn, trails physicsPos while a far body blends between syncs
+  glm::vec3 physicsPos;  // where the collider really is, what gameplay and physics LOD measure from
   glm::vec3 rotationZYX; // degrees
   glm::vec3 scale;
   int id;
@@ -32,24 +38,62 @@ public:
   btCollisionObject *collisionObject = nullptr;
   btMotionState *motionState = nullptr;
   btRigidBody *rigidBody = nullptr;
-  TextureManager textureManager;
+  CharacterController *characterController = nullptr;
+  TextureHandle texture = INVALID_TEXTURE;        // shared image, written into each instance as its bindless array index
+  TextureHandle pendingTexture = INVALID_TEXTURE; // swapped in for texture once its async upload is ready
+  BoundingVolume localBounds; // filled by initGraphics, used for frustum culling
+  MeshHandle mesh = INVALID_MESH; // shared GPU buffers, objects with the same handle are drawn instanced
   GameObjectTags tag;
 
+  PhysicsLodLevel physicsLodLevel = PhysicsLodLevel::Near;
+  int physicsSyncInterval = 1; // changed through setPhysicsSyncInterval
+
   GameObject(Renderer &renderer, int id, PhysicsConfig &config, const glm::vec3 &pos, const glm::vec3 &scale, const glm::vec3 &rotationZYX, std::vector<Vertex> vertices, std::vector<uint32_t> indices, GameObjectTags tag = GameObjectTags::None);
   ~GameObject() {}
 
-  void draw(Renderer *renderer, int currentFrame, glm::mat4 view, glm::mat4 projectionMatrix, VkCommandBuffer commandBuffer);
-  void loadModel(const std::string MODEL_PATH);
+  glm::mat4 getModelMatrix() const;
+  // Draws instanceCount copies of this mesh, the renderer binds the descriptor sets and the instance buffer that
+  // carries each copy's model matrix and texture
+  void draw(Renderer *renderer, VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance);
+  MeshOptimizationStats loadModel(const std::string MODEL_PATH); // welds and reorders the mesh for the vertex cache
+  void buildConvexHulls();
   void setVerticesAndIndices(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
-  void initGraphics(Renderer &renderer, std::string texturePath);
+  void initGraphics(Renderer &renderer, std::string texturePath); // drops the CPU mesh afterwards unless the collider needs it
+  void cleanupGraphics(Renderer &renderer);
+  // Takes over one reference to handle, drawn from the next frame on or, while it uploads, kept as pendingTexture
+  void setTexture(Renderer &renderer, TextureHandle handle);
+  void applyPendingTexture(Renderer &renderer); // once its upload landed, a failed one is dropped and the old texture stays
 
   void initPhysics(btDiscreteDynamicsWorld *dynamicsWorld);
+  void updateKinematic(float deltaTime); // moves kinematic bodies along their motion state, call before stepping
   void updatePhysics();
+  void setPhysicsSyncInterval(int interval); // restarts the blend between synced transforms from the one shown
   void cleanupPhysics(btDiscreteDynamicsWorld *dynamicsWorld);
 
-  void setScale(const glm::vec3 &newScale);
+  int getCollisionGroup() const;
+  bool getWorldBounds(glm::vec3 &minCorner, glm::vec3 &maxCorner) const; // from the render vertices, false without any
+
+  bool setScale(const glm::vec3 &newScale); // false when a character has no room to grow, the scale stays as it was
   void setPosition(const glm::vec3 &newPosition);
 
   std::vector<Vertex> vertices;
   std::vector<uint32_t> indices;
+
+  std::string modelPath;
+  std::vector<size_t> shapeIndexOffsets;           // first index of every OBJ shape, filled by loadModel
+  std::vector<std::vector<glm::vec3>> convexHulls; // unscaled hull points for ConvexHull/ConvexDecomposition colliders
+
+private:
+  int stepsSinceSync = 0;
+  glm::vec3 syncedFromPos = glm::vec3(0);
+  glm::vec3 syncedToPos = glm::vec3(0);
+  btQuaternion syncedFromRotation = btQuaternion::getIdentity();
+  btQuaternion syncedToRotation = btQuaternion::getIdentity();
+
+  void showRotation(const btQuaternion &rotation); // into rotationZYX, for the axes the body may rotate about
+  bool needsCpuMesh() const;
+  glm::vec3 scaledLocalSize() const; // size of localBounds after scaling
+  btCollisionShape *createConvexHullShape();
+  bool loadConvexHullCache(const std::string &cachePath);
+  void saveConvexHullCache(const std::string &cachePath);
 };
\ No newline at end of file
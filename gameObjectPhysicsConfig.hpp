@@ -6,12 +6,29 @@ enum class ColliderType
 {
   None,
   Box,
-  Mesh
+  Mesh,
+  ConvexHull,
+  ConvexDecomposition
+};
+
+// Collision categories. Two objects only generate contacts, and a query only visits an object, when
+// the groups and masks accept each other.
+enum CollisionGroup
+{
+  StaticWorldGroup = 1 << 0,
+  DynamicPropGroup = 1 << 1,
+  PlayerGroup = 1 << 2,
+  RemotePlayerGroup = 1 << 3,
+  TriggerGroup = 1 << 4,
+  AllGroups = -1
 };
 
 struct PhysicsConfig
 {
   bool isRigidBody;
+  bool isCharacter = false; // driven by a kinematic CharacterController instead of a rigid body
+  bool isKinematic = false; // moved through a KinematicMotionState (e.g. by the network), needs isRigidBody = true
+  bool isTrigger = false;   // ghost object that only reports enter/exit events, needs isRigidBody = false
   ColliderType collider;
   bool interactable = true;
   bool canMove = true;
@@ -24,6 +41,9 @@ struct PhysicsConfig
   float linearDamping = 0.0;
   float angularDamping = 0.0;
   float meshColliderMargin = 0.04;
+  int convexHullMaxVertices = 32; // per hull, used by ConvexHull and ConvexDecomposition
+  int collisionGroup = 0;         // CollisionGroup bit, 0 derives it from the flags above
+  int collisionMask = 0;          // CollisionGroup bits, 0 uses the default mask of collisionGroup
   glm::vec3 boxColliderSize;
   PhysicsConfig() : boxColliderSize(-1) {}
 };
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include "gpuAllocator.hpp"
+#include "utils.h"
+#include <algorithm>
+#include <stdexcept>
+
+void GpuAllocator::init(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+  this->device = device;
+  this->physicalDevice = physicalDevice;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  bufferImageGranularity = properties.limits.bufferImageGranularity;
+
+  maxOrder = 0;
+  while ((GPU_ALLOCATOR_MIN_NODE << maxOrder) < GPU_ALLOCATOR_BLOCK_SIZE)
+  {
+    maxOrder++;
+  }
+}
+
+void GpuAllocator::cleanup(VkDevice device)
+{
+  for (Pool &pool : pools)
+  {
+    for (Block &block : pool.blocks)
+    {
+      if (block.memory != VK_NULL_HANDLE)
+      {
+        vkFreeMemory(device, block.memory, nullptr);
+      }
+    }
+  }
+  for (DedicatedAllocation &allocation : dedicated)
+  {
+    vkFreeMemory(device, allocation.memory, nullptr);
+  }
+  pools.clear();
+  dedicated.clear();
+}
+
+GpuAllocation GpuAllocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear)
+{
+  GpuAllocation allocation;
+  allocation.size = requirements.size;
+  uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties, physicalDevice);
+  totalAllocations++;
+
+  // anything bigger than half a block would waste most of it, give it its own memory
+  if (requirements.size > GPU_ALLOCATOR_BLOCK_SIZE / 2)
+  {
+    allocation.memory = allocateDeviceMemory(requirements.size, memoryTypeIndex, &allocation.mapped);
+    dedicated.push_back({allocation.memory, requirements.size, requirements.size});
+    return allocation;
+  }
+
+  // a node is aligned to its own size, so rounding up to the alignment covers it as well
+  VkDeviceSize needed = std::max({requirements.size, requirements.alignment, GPU_ALLOCATOR_MIN_NODE});
+  uint32_t order = 0;
+  while ((GPU_ALLOCATOR_MIN_NODE << order) < needed)
+  {
+    order++;
+  }
+
+  int poolIndex = findPool(memoryTypeIndex, linear);
+  Pool &pool = pools[poolIndex];
+  int blockIndex = -1;
+  VkDeviceSize offset = 0;
+  for (size_t i = 0; i < pool.blocks.size(); i++)
+  {
+    if (pool.blocks[i].memory != VK_NULL_HANDLE && allocateFromBlock(pool.blocks[i], order, offset))
+    {
+      blockIndex = static_cast<int>(i);
+      break;
+    }
+  }
+
+  if (blockIndex < 0)
+  {
+    for (size_t i = 0; i < pool.blocks.size() && blockIndex < 0; i++)
+    {
+      if (pool.blocks[i].memory == VK_NULL_HANDLE)
+      {
+        blockIndex = static_cast<int>(i);
+      }
+    }
+    if (blockIndex < 0)
+    {
+      blockIndex = static_cast<int>(pool.blocks.size());
+      pool.blocks.emplace_back();
+    }
+    createBlock(pool, pool.blocks[blockIndex]);
+    allocateFromBlock(pool.blocks[blockIndex], order, offset);
+  }
+
+  Block &block = pool.blocks[blockIndex];
+  block.allocationCount++;
+  block.usedBytes += GPU_ALLOCATOR_MIN_NODE << order;
+  block.requestedBytes += requirements.size;
+
+  allocation.memory = block.memory;
+  allocation.offset = offset;
+  allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+  allocation.pool = poolIndex;
+  allocation.block = blockIndex;
+  allocation.order = order;
+  return allocation;
+}
+
+void GpuAllocator::free(GpuAllocation &allocation)
+{
+  if (allocation.memory == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  if (allocation.block < 0)
+  {
+    auto it = std::find_if(dedicated.begin(), dedicated.end(), [&allocation](const DedicatedAllocation &candidate)
+                           { return candidate.memory == allocation.memory; });
+    if (it != dedicated.end())
+    {
+      vkFreeMemory(device, it->memory, nullptr);
+      dedicated.erase(it);
+    }
+    allocation = GpuAllocation{};
+    return;
+  }
+
+  Pool &pool = pools[allocation.pool];
+  Block &block = pool.blocks[allocation.block];
+  block.allocationCount--;
+  block.usedBytes -= GPU_ALLOCATOR_MIN_NODE << allocation.order;
+  block.requestedBytes -= allocation.size;
+
+  // merge with the buddy for as long as it is free too
+  VkDeviceSize offset = allocation.offset;
+  uint32_t order = allocation.order;
+  while (order < maxOrder)
+  {
+    VkDeviceSize buddy = offset ^ (GPU_ALLOCATOR_MIN_NODE << order);
+    auto it = block.freeNodes[order].find(buddy);
+    if (it == block.freeNodes[order].end())
+    {
+      break;
+    }
+    block.freeNodes[order].erase(it);
+    offset = std::min(offset, buddy);
+    order++;
+  }
+  block.freeNodes[order].insert(offset);
+
+  // give an empty block back, unless it is the last one the pool has
+  if (block.allocationCount == 0)
+  {
+    size_t liveBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const Block &candidate)
+                                      { return candidate.memory != VK_NULL_HANDLE; });
+    if (liveBlocks > 1)
+    {
+      vkFreeMemory(device, block.memory, nullptr);
+      block = Block{};
+    }
+  }
+
+  allocation = GpuAllocation{};
+}
+
+GpuAllocatorStats GpuAllocator::stats() const
+{
+  GpuAllocatorStats stats;
+  stats.totalDeviceAllocations = totalDeviceAllocations;
+  stats.totalAllocations = totalAllocations;
+
+  for (const Pool &pool : pools)
+  {
+    for (const Block &block : pool.blocks)
+    {
+      if (block.memory == VK_NULL_HANDLE)
+      {
+        continue;
+      }
+
+      stats.deviceMemoryCount++;
+      stats.allocationCount += block.allocationCount;
+      stats.reservedBytes += GPU_ALLOCATOR_BLOCK_SIZE;
+      stats.usedBytes += block.usedBytes;
+      stats.requestedBytes += block.requestedBytes;
+      stats.freeBytes += GPU_ALLOCATOR_BLOCK_SIZE - block.usedBytes;
+      for (uint32_t order = maxOrder + 1; order-- > 0;)
+      {
+        if (!block.freeNodes[order].empty())
+        {
+          stats.largestFreeBytes = std::max(stats.largestFreeBytes, GPU_ALLOCATOR_MIN_NODE << order);
+          break;
+        }
+      }
+    }
+  }
+
+  for (const DedicatedAllocation &allocation : dedicated)
+  {
+    stats.deviceMemoryCount++;
+    stats.allocationCount++;
+    stats.reservedBytes += allocation.size;
+    stats.usedBytes += allocation.size;
+    stats.requestedBytes += allocation.requestedBytes;
+  }
+  return stats;
+}
+
+void GpuAllocator::printStats(std::ostream &out) const
+{
+  const double MiB = 1024.0 * 1024.0;
+  GpuAllocatorStats total = stats();
+
+  out << "GPU memory: " << total.allocationCount << " allocations in " << total.deviceMemoryCount << " device memory objects ("
+      << total.totalAllocations << " allocations and " << total.totalDeviceAllocations << " vkAllocateMemory calls since start)" << std::endl;
+  out << "  requested " << total.requestedBytes / MiB << " MiB, nodes " << total.usedBytes / MiB << " MiB, reserved " << total.reservedBytes / MiB
+      << " MiB, overhead " << (total.reservedBytes - total.requestedBytes) / MiB << " MiB" << std::endl;
+  out << "  buffer/image granularity " << bufferImageGranularity << " B, handled by keeping buffers and optimal images in separate pools" << std::endl;
+
+  for (const Pool &pool : pools)
+  {
+    size_t blockCount = 0;
+    size_t allocationCount = 0;
+    VkDeviceSize used = 0;
+    VkDeviceSize largestFree = 0;
+    for (const Block &block : pool.blocks)
+    {
+      if (block.memory == VK_NULL_HANDLE)
+      {
+        continue;
+      }
+      blockCount++;
+      allocationCount += block.allocationCount;
+      used += block.usedBytes;
+      for (uint32_t order = maxOrder + 1; order-- > 0;)
+      {
+        if (!block.freeNodes[order].empty())
+        {
+          largestFree = std::max(largestFree, GPU_ALLOCATOR_MIN_NODE << order);
+          break;
+        }
+      }
+    }
+    if (blockCount == 0)
+    {
+      continue;
+    }
+
+    VkDeviceSize freeBytes = blockCount * GPU_ALLOCATOR_BLOCK_SIZE - used;
+    float fragmentation = freeBytes == 0 ? 0.0f : 1.0f - static_cast<float>(largestFree) / static_cast<float>(freeBytes);
+    out << "  type " << pool.memoryTypeIndex << (pool.linear ? " buffers" : " images") << (pool.hostVisible ? " (host visible)" : "") << ": "
+        << allocationCount << " allocations in " << blockCount << " blocks, " << used / MiB << " MiB used, largest free "
+        << largestFree / MiB << " MiB, fragmentation " << fragmentation << std::endl;
+  }
+  if (!dedicated.empty())
+  {
+    out << "  " << dedicated.size() << " dedicated allocations" << std::endl;
+  }
+}
+
+int GpuAllocator::findPool(uint32_t memoryTypeIndex, bool linear)
+{
+  for (size_t i = 0; i < pools.size(); i++)
+  {
+    if (pools[i].memoryTypeIndex == memoryTypeIndex && pools[i].linear == linear)
+    {
+      return static_cast<int>(i);
+    }
+  }
+
+  Pool pool;
+  pool.memoryTypeIndex = memoryTypeIndex;
+  pool.linear = linear;
+  pool.hostVisible = (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+  pools.push_back(pool);
+  return static_cast<int>(pools.size() - 1);
+}
+
+bool GpuAllocator::allocateFromBlock(Block &block, uint32_t order, VkDeviceSize &offset)
+{
+  uint32_t found = order;
+  while (found <= maxOrder && block.freeNodes[found].empty())
+  {
+    found++;
+  }
+  if (found > maxOrder)
+  {
+    return false;
+  }
+
+  offset = *block.freeNodes[found].begin();
+  block.freeNodes[found].erase(block.freeNodes[found].begin());
+
+  // split down, keeping the lower half and freeing the upper one at each step
+  while (found > order)
+  {
+    found--;
+    block.freeNodes[found].insert(offset + (GPU_ALLOCATOR_MIN_NODE << found));
+  }
+  return true;
+}
+
+void GpuAllocator::createBlock(Pool &pool, Block &block)
+{
+  void *mapped = nullptr;
+  block.memory = allocateDeviceMemory(GPU_ALLOCATOR_BLOCK_SIZE, pool.memoryTypeIndex, pool.hostVisible ? &mapped : nullptr);
+  block.mapped = static_cast<unsigned char *>(mapped);
+  block.freeNodes.assign(maxOrder + 1, {});
+  block.freeNodes[maxOrder].insert(0);
+  block.allocationCount = 0;
+  block.usedBytes = 0;
+  block.requestedBytes = 0;
+}
+
+VkDeviceMemory GpuAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped)
+{
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to allocate device memory!");
+  }
+  totalDeviceAllocations++;
+
+  if (mapped && (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+  {
+    vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+  }
+  return memory;
+}
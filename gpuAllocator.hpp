@@ -0,0 +1,93 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <set>
+#include <ostream>
+
+#define GPU_ALLOCATOR_BLOCK_SIZE ((VkDeviceSize)64 * 1024 * 1024) // one vkAllocateMemory per block
+#define GPU_ALLOCATOR_MIN_NODE ((VkDeviceSize)256)                // smallest buddy, also the worst case alignment it has to honour
+
+struct GpuAllocation
+{
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;   // what was asked for, the node behind it is rounded up to a power of two
+  void *mapped = nullptr;  // set for host-visible memory, blocks stay mapped for their whole life
+  int pool = -1;
+  int block = -1;          // -1 for a dedicated allocation
+  uint32_t order = 0;
+};
+
+struct GpuAllocatorStats
+{
+  size_t deviceMemoryCount = 0;    // live vkAllocateMemory objects
+  size_t allocationCount = 0;      // live allocations handed out
+  size_t totalDeviceAllocations = 0;
+  size_t totalAllocations = 0;
+  VkDeviceSize reservedBytes = 0;  // sum of every block and dedicated allocation
+  VkDeviceSize usedBytes = 0;      // buddy nodes handed out
+  VkDeviceSize requestedBytes = 0; // what callers asked for
+  VkDeviceSize freeBytes = 0;
+  VkDeviceSize largestFreeBytes = 0;
+
+  // 0 when all free space is one node, towards 1 as it splits into small pieces
+  float fragmentation() const { return freeBytes == 0 ? 0.0f : 1.0f - static_cast<float>(largestFreeBytes) / static_cast<float>(freeBytes); }
+};
+
+// Suballocates buffers and images out of large blocks with a buddy scheme, so the renderer makes a
+// handful of vkAllocateMemory calls instead of one per resource. Buffers and optimal-tiling images
+// get separate pools, which keeps them out of each other's bufferImageGranularity pages.
+class GpuAllocator
+{
+public:
+  void init(VkDevice device, VkPhysicalDevice physicalDevice);
+  void cleanup(VkDevice device);
+
+  // linear is true for buffers and linear-tiling images
+  GpuAllocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear);
+  void free(GpuAllocation &allocation);
+
+  GpuAllocatorStats stats() const;
+  void printStats(std::ostream &out) const;
+
+private:
+  struct Block
+  {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    unsigned char *mapped = nullptr;
+    std::vector<std::set<VkDeviceSize>> freeNodes; // offsets of free nodes, indexed by order
+    size_t allocationCount = 0;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize requestedBytes = 0;
+  };
+
+  struct Pool
+  {
+    uint32_t memoryTypeIndex;
+    bool linear;
+    bool hostVisible;
+    std::vector<Block> blocks; // emptied slots keep their index so allocations can point at them
+  };
+
+  struct DedicatedAllocation
+  {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    VkDeviceSize requestedBytes;
+  };
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties memoryProperties{};
+  VkDeviceSize bufferImageGranularity = 1;
+  uint32_t maxOrder = 0;
+  std::vector<Pool> pools;
+  std::vector<DedicatedAllocation> dedicated;
+  size_t totalDeviceAllocations = 0;
+  size_t totalAllocations = 0;
+
+  int findPool(uint32_t memoryTypeIndex, bool linear);
+  bool allocateFromBlock(Block &block, uint32_t order, VkDeviceSize &offset);
+  void createBlock(Pool &pool, Block &block);
+  VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped);
+};
@@ -0,0 +1,52 @@
+#include "inputRecording.hpp"
+#include <fstream>
+#include <iostream>
+
+#define INPUT_RECORDING_MAGIC 0x54504E49 // "INPT"
+#define INPUT_RECORDING_VERSION 1
+
+bool InputRecording::save(const std::string &path) const
+{
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    std::cerr << "Failed to write input recording: " << path << std::endl;
+    return false;
+  }
+
+  uint32_t header[3] = {INPUT_RECORDING_MAGIC, INPUT_RECORDING_VERSION, static_cast<uint32_t>(frames.size())};
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(&fixedTimestep), sizeof(fixedTimestep));
+  file.write(reinterpret_cast<const char *>(frames.data()), frames.size() * sizeof(InputFrame));
+
+  return static_cast<bool>(file);
+}
+
+bool InputRecording::load(const std::string &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  uint32_t header[3];
+  file.read(reinterpret_cast<char *>(header), sizeof(header));
+  if (!file || header[0] != INPUT_RECORDING_MAGIC || header[1] != INPUT_RECORDING_VERSION)
+  {
+    return false;
+  }
+
+  std::vector<InputFrame> loadedFrames(header[2]);
+  float loadedTimestep = 0.0f;
+  file.read(reinterpret_cast<char *>(&loadedTimestep), sizeof(loadedTimestep));
+  file.read(reinterpret_cast<char *>(loadedFrames.data()), loadedFrames.size() * sizeof(InputFrame));
+  if (!file || loadedTimestep <= 0.0f)
+  {
+    return false;
+  }
+
+  fixedTimestep = loadedTimestep;
+  frames = loadedFrames;
+  return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define INPUT_KEY_W (1u << 0)
+#define INPUT_KEY_A (1u << 1)
+#define INPUT_KEY_S (1u << 2)
+#define INPUT_KEY_D (1u << 3)
+#define INPUT_KEY_SPACE (1u << 4)
+#define INPUT_KEY_LEFT_SHIFT (1u << 5)
+#define INPUT_KEY_LEFT_CONTROL (1u << 6)
+
+// Everything gameplay reads from the player during one simulation tick.
+struct InputFrame
+{
+  uint32_t keys = 0; // INPUT_KEY_* bits
+  float mouseDeltaX = 0.0f;
+  float mouseDeltaY = 0.0f;
+
+  bool isDown(uint32_t key) const { return (keys & key) != 0; }
+};
+
+// One InputFrame per fixed tick. Replaying the frames with the same timestep reproduces the session,
+// since the simulation reads no other clock or input.
+class InputRecording
+{
+public:
+  float fixedTimestep = 1.0f / 60.0f;
+  std::vector<InputFrame> frames;
+
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
+};
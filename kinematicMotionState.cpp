@@ -0,0 +1,49 @@
+#include "kinematicMotionState.hpp"
+
+KinematicMotionState::KinematicMotionState(const btTransform &startTransform, float interpolationTime) : interpolationTime(interpolationTime), previous(startTransform), target(startTransform), current(startTransform)
+{
+}
+
+void KinematicMotionState::setTarget(const btTransform &newTarget)
+{
+  // the first snapshot places the body, it should not glide in from its spawn point
+  previous = hasTarget ? current : newTarget;
+  target = newTarget;
+  elapsed = 0.0f;
+  hasTarget = true;
+
+  if (previous == target)
+  {
+    current = target;
+  }
+}
+
+void KinematicMotionState::advance(float deltaTime)
+{
+  if (current == target)
+  {
+    return;
+  }
+
+  elapsed += deltaTime;
+  float t = interpolationTime > 0.0f ? btMin(elapsed / interpolationTime, 1.0f) : 1.0f;
+
+  if (t >= 1.0f)
+  {
+    current = target;
+    return;
+  }
+
+  current.setOrigin(previous.getOrigin().lerp(target.getOrigin(), t));
+  current.setRotation(previous.getRotation().slerp(target.getRotation(), t));
+}
+
+void KinematicMotionState::getWorldTransform(btTransform &worldTransform) const
+{
+  worldTransform = current;
+}
+
+void KinematicMotionState::setWorldTransform(const btTransform &worldTransform)
+{
+  // Bullet never writes back to kinematic bodies, the snapshots are the only source of truth
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <btBulletDynamicsCommon.h>
+
+// Motion state for kinematic bodies driven by network snapshots. Bullet reads the transform from here
+// every step and derives the body's velocity from how far it moved, so contacts with remote players
+// behave like contacts with a moving object instead of a teleporting one.
+class KinematicMotionState : public btMotionState
+{
+public:
+  float interpolationTime; // seconds to blend towards a new target, roughly the snapshot interval
+
+  KinematicMotionState(const btTransform &startTransform, float interpolationTime = 0.1f);
+
+  void setTarget(const btTransform &target);
+  void advance(float deltaTime);
+
+  void getWorldTransform(btTransform &worldTransform) const override;
+  void setWorldTransform(const btTransform &worldTransform) override;
+
+private:
+  btTransform previous;
+  btTransform target;
+  btTransform current;
+  float elapsed = 0.0f;
+  bool hasTarget = false;
+};
@@ -17,12 +17,126 @@
 #include <tiny_obj_loader.h>
 
 #include "application.hpp"
+#include "physicsBenchmark.hpp"
+#include "meshOptimizer.hpp"
+#include "textureBaker.hpp"
 
-int main()
+int main(int argc, char **argv)
 {
+    if (argc >= 2 && std::string(argv[1]) == "--bench-colliders")
+    {
+        Camera camera;
+        uint32_t width = 0, height = 0;
+        Renderer renderer(camera, width, height);
+        runColliderBenchmark(renderer, argc >= 3 ? std::atoi(argv[2]) : 16);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--bench-lod")
+    {
+        Camera camera;
+        uint32_t width = 0, height = 0;
+        Renderer renderer(camera, width, height);
+        runLodBenchmark(renderer, argc >= 3 ? std::atoi(argv[2]) : 500);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--bench-broadphase")
+    {
+        Camera camera;
+        uint32_t width = 0, height = 0;
+        Renderer renderer(camera, width, height);
+        runBroadphaseBenchmark(renderer, argc >= 3 ? std::atoi(argv[2]) : 2000);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--mesh-opt-report")
+    {
+        Camera camera;
+        uint32_t width = 0, height = 0;
+        Renderer renderer(camera, width, height);
+        runMeshOptimizationReport(renderer);
+        return EXIT_SUCCESS;
+    }
+
+    // --bake-textures [dir...] writes BC1 .ktx2 files next to the PNGs, the renderer prefers them
+    if (argc >= 2 && std::string(argv[1]) == "--bake-textures")
+    {
+        std::vector<std::string> directories(argv + 2, argv + argc);
+        if (directories.empty())
+        {
+            directories = {"textures", "models"};
+        }
+        runTextureBake(directories);
+        return EXIT_SUCCESS;
+    }
+
     Application app;
     try
     {
+        for (int i = 1; i < argc; i++)
+        {
+            // --profile-physics [file.csv] prints a rolling summary and optionally logs every step
+            if (std::string(argv[i]) == "--profile-physics")
+            {
+                app.printPhysicsStats = true;
+                if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0)
+                {
+                    app.physicsProfiler.openCsv(argv[i + 1]);
+                }
+            }
+            else if (std::string(argv[i]) == "--broadphase-sap")
+            {
+                app.broadphaseSettings.type = BroadphaseType::AxisSweep;
+            }
+        }
+
+        if (argc >= 3 && std::string(argv[1]) == "--replay")
+        {
+            app.replay(argv[2]);
+            return EXIT_SUCCESS;
+        }
+
+        // --check-raybatch file replays a recording with the rays cast one by one and batched, then compares the two
+        if (argc >= 3 && std::string(argv[1]) == "--check-raybatch")
+        {
+            return Application::checkRayBatch(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        if (argc >= 2 && std::string(argv[1]) == "--mesh-report")
+        {
+            app.meshReport(argc >= 3 ? std::atoi(argv[2]) : 64);
+            return EXIT_SUCCESS;
+        }
+
+        // --bench-render [count...] grows the scene to each count, 1k, 10k and 50k objects by default
+        if (argc >= 2 && std::string(argv[1]) == "--bench-render")
+        {
+            std::vector<int> counts;
+            for (int i = 2; i < argc && std::string(argv[i]).rfind("--", 0) != 0; i++)
+            {
+                counts.push_back(std::atoi(argv[i]));
+            }
+            if (counts.empty())
+            {
+                counts = {1000, 10000, 50000};
+            }
+            app.benchRender(counts);
+            return EXIT_SUCCESS;
+        }
+
+        // --stress-players [players] [rounds]
+        if (argc >= 2 && std::string(argv[1]) == "--stress-players")
+        {
+            app.stressPlayers(argc >= 3 ? std::atoi(argv[2]) : 300, argc >= 4 ? std::atoi(argv[3]) : 5);
+            return EXIT_SUCCESS;
+        }
+
+        if (argc >= 3 && std::string(argv[1]) == "--record")
+        {
+            app.recordPath = argv[2];
+        }
+
         app.run();
     }
     catch (const std::exception &e)
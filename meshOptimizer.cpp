@@ -0,0 +1,309 @@
+#include "meshOptimizer.hpp"
+#include "vertex.h"
+#include "gameObject.hpp"
+#include "gameObjectPhysicsConfig.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+struct WeldKey
+{
+  uint32_t bits[6];
+  uint8_t color[3];
+
+  bool operator==(const WeldKey &other) const
+  {
+    return std::memcmp(bits, other.bits, sizeof(bits)) == 0 && std::memcmp(color, other.color, sizeof(color)) == 0;
+  }
+};
+
+struct WeldKeyHash
+{
+  size_t operator()(const WeldKey &key) const
+  {
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t word : key.bits)
+    {
+      hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (uint8_t channel : key.color)
+    {
+      hash = (hash ^ channel) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+  }
+};
+
+// compares bit patterns so -0 and 0 stay apart, which is fine for data that came from the same file
+static WeldKey makeWeldKey(const Vertex &vertex)
+{
+  WeldKey key;
+  std::memcpy(&key.bits[0], &vertex.pos, sizeof(float) * 3);
+  std::memcpy(&key.bits[3], &vertex.texPos, sizeof(float) * 2);
+  key.bits[5] = 0;
+  key.color[0] = vertex.color.x;
+  key.color[1] = vertex.color.y;
+  key.color[2] = vertex.color.z;
+  return key;
+}
+
+void weldVertices(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+  std::unordered_map<WeldKey, uint32_t, WeldKeyHash> uniqueVertices;
+  uniqueVertices.reserve(vertices.size());
+
+  std::vector<Vertex> weldedVertices;
+  weldedVertices.reserve(vertices.size());
+  std::vector<uint32_t> remap(vertices.size());
+
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    auto inserted = uniqueVertices.emplace(makeWeldKey(vertices[i]), static_cast<uint32_t>(weldedVertices.size()));
+    if (inserted.second)
+    {
+      weldedVertices.push_back(vertices[i]);
+    }
+    remap[i] = inserted.first->second;
+  }
+
+  for (uint32_t &index : indices)
+  {
+    index = remap[index];
+  }
+  vertices.swap(weldedVertices);
+}
+
+static float forsythVertexScore(int cachePosition, int activeTriangles)
+{
+  if (activeTriangles == 0)
+  {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0)
+  {
+    // the triangle that was just added keeps a fixed score so it does not favour one of its own corners
+    if (cachePosition < 3)
+    {
+      score = 0.75f;
+    }
+    else
+    {
+      float scale = 1.0f / (VERTEX_CACHE_SIZE - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+    }
+  }
+
+  // vertices with few triangles left get a boost so they are finished off and leave the working set
+  return score + 2.0f * std::pow(static_cast<float>(activeTriangles), -0.5f);
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t indexBegin, size_t indexEnd, size_t vertexCount)
+{
+  size_t triangleCount = (indexEnd - indexBegin) / 3;
+  if (triangleCount < 2)
+  {
+    return;
+  }
+
+  // work on local vertex ids so a small part of a large mesh stays cheap
+  std::unordered_map<uint32_t, uint32_t> localIds;
+  localIds.reserve(std::min(vertexCount, triangleCount * 3));
+  std::vector<uint32_t> localIndices(triangleCount * 3);
+  for (size_t i = 0; i < localIndices.size(); i++)
+  {
+    auto inserted = localIds.emplace(indices[indexBegin + i], static_cast<uint32_t>(localIds.size()));
+    localIndices[i] = inserted.first->second;
+  }
+  size_t localVertexCount = localIds.size();
+
+  std::vector<int> activeTriangles(localVertexCount, 0);
+  for (uint32_t index : localIndices)
+  {
+    activeTriangles[index]++;
+  }
+
+  // triangles of every vertex, packed, with the unfinished ones kept at the front of each list
+  std::vector<uint32_t> triangleListOffset(localVertexCount + 1, 0);
+  for (size_t v = 0; v < localVertexCount; v++)
+  {
+    triangleListOffset[v + 1] = triangleListOffset[v] + activeTriangles[v];
+  }
+  std::vector<uint32_t> vertexTriangles(localIndices.size());
+  std::vector<uint32_t> fill(triangleListOffset.begin(), triangleListOffset.end() - 1);
+  for (size_t t = 0; t < triangleCount; t++)
+  {
+    for (int corner = 0; corner < 3; corner++)
+    {
+      uint32_t v = localIndices[t * 3 + corner];
+      vertexTriangles[fill[v]++] = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<int> cachePosition(localVertexCount, -1);
+  std::vector<float> vertexScore(localVertexCount);
+  for (size_t v = 0; v < localVertexCount; v++)
+  {
+    vertexScore[v] = forsythVertexScore(-1, activeTriangles[v]);
+  }
+
+  std::vector<bool> triangleAdded(triangleCount, false);
+
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> nextCache;
+  cache.reserve(VERTEX_CACHE_SIZE + 3);
+  nextCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+  std::vector<uint32_t> output;
+  output.reserve(localIndices.size());
+
+  int bestTriangle = -1;
+  size_t scanCursor = 0;
+  for (size_t added = 0; added < triangleCount; added++)
+  {
+    // nothing useful in the cache, restart from the next unused triangle in input order
+    if (bestTriangle < 0)
+    {
+      while (triangleAdded[scanCursor])
+      {
+        scanCursor++;
+      }
+      bestTriangle = static_cast<int>(scanCursor);
+    }
+
+    triangleAdded[bestTriangle] = true;
+    const uint32_t *corners = &localIndices[bestTriangle * 3];
+
+    nextCache.clear();
+    for (int corner = 0; corner < 3; corner++)
+    {
+      uint32_t v = corners[corner];
+      output.push_back(v);
+      nextCache.push_back(v);
+
+      // take the triangle out of the vertex's active list
+      uint32_t begin = triangleListOffset[v];
+      uint32_t end = begin + activeTriangles[v];
+      for (uint32_t i = begin; i < end; i++)
+      {
+        if (vertexTriangles[i] == static_cast<uint32_t>(bestTriangle))
+        {
+          std::swap(vertexTriangles[i], vertexTriangles[end - 1]);
+          break;
+        }
+      }
+      activeTriangles[v]--;
+    }
+
+    for (uint32_t v : cache)
+    {
+      if (v != corners[0] && v != corners[1] && v != corners[2])
+      {
+        nextCache.push_back(v);
+      }
+    }
+    cache.swap(nextCache);
+
+    for (size_t i = 0; i < cache.size(); i++)
+    {
+      uint32_t v = cache[i];
+      cachePosition[v] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+      vertexScore[v] = forsythVertexScore(cachePosition[v], activeTriangles[v]);
+    }
+    if (cache.size() > VERTEX_CACHE_SIZE)
+    {
+      cache.resize(VERTEX_CACHE_SIZE);
+    }
+
+    // only triangles touching the cache changed score, the best of them goes next
+    bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (uint32_t v : cache)
+    {
+      uint32_t begin = triangleListOffset[v];
+      uint32_t end = begin + activeTriangles[v];
+      for (uint32_t i = begin; i < end; i++)
+      {
+        uint32_t t = vertexTriangles[i];
+        float score = vertexScore[localIndices[t * 3]] + vertexScore[localIndices[t * 3 + 1]] + vertexScore[localIndices[t * 3 + 2]];
+        if (score > bestScore)
+        {
+          bestScore = score;
+          bestTriangle = static_cast<int>(t);
+        }
+      }
+    }
+  }
+
+  std::vector<uint32_t> globalIds(localVertexCount);
+  for (const auto &entry : localIds)
+  {
+    globalIds[entry.second] = entry.first;
+  }
+  for (size_t i = 0; i < output.size(); i++)
+  {
+    indices[indexBegin + i] = globalIds[output[i]];
+  }
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+  const uint32_t unassigned = UINT32_MAX;
+  std::vector<uint32_t> remap(vertices.size(), unassigned);
+  std::vector<Vertex> orderedVertices;
+  orderedVertices.reserve(vertices.size());
+
+  for (uint32_t &index : indices)
+  {
+    if (remap[index] == unassigned)
+    {
+      remap[index] = static_cast<uint32_t>(orderedVertices.size());
+      orderedVertices.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices.swap(orderedVertices);
+}
+
+float computeAcmr(const std::vector<uint32_t> &indices, size_t vertexCount, int cacheSize)
+{
+  if (indices.size() < 3)
+  {
+    return 0.0f;
+  }
+
+  // FIFO cache: a vertex is a hit while fewer than cacheSize misses happened since it was loaded
+  std::vector<size_t> loadedAt(vertexCount, 0);
+  size_t misses = 0;
+  for (uint32_t index : indices)
+  {
+    if (loadedAt[index] == 0 || misses - loadedAt[index] >= static_cast<size_t>(cacheSize))
+    {
+      misses++;
+      loadedAt[index] = misses;
+    }
+  }
+  return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+void runMeshOptimizationReport(Renderer &renderer)
+{
+  const char *modelPaths[] = {"models/couch/couch1.obj", "models/testMap/testMap.obj"};
+
+  PhysicsConfig config;
+  config.collider = ColliderType::None;
+
+  for (const char *modelPath : modelPaths)
+  {
+    GameObject gameObject(renderer, 0, config, glm::vec3(0), glm::vec3(1), glm::vec3(0), {}, {});
+    MeshOptimizationStats stats = gameObject.loadModel(modelPath);
+
+    std::cout << modelPath << ": " << stats.triangles << " triangles" << std::endl;
+    std::cout << "  vertices " << stats.sourceVertices << " -> " << stats.uniqueVertices << " (" << 100.0f * stats.uniqueVertices / std::max<size_t>(stats.sourceVertices, 1) << "% unique)" << std::endl;
+    std::cout << "  ACMR (FIFO " << ACMR_CACHE_SIZE << ") " << stats.acmrSource << " source, " << stats.acmrWelded << " welded, " << stats.acmrOptimized << " optimized" << std::endl;
+    std::cout << "  index format " << (stats.uniqueVertices <= UINT16_MAX + 1 ? "uint16" : "uint32") << std::endl;
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct Vertex;
+class Renderer;
+
+#define VERTEX_CACHE_SIZE 32 // post-transform cache modelled by optimizeVertexCache
+#define ACMR_CACHE_SIZE 16   // FIFO size used when reporting ACMR
+
+struct MeshOptimizationStats
+{
+  size_t sourceVertices = 0; // one per face corner, as the OBJ loader emits them
+  size_t uniqueVertices = 0;
+  size_t triangles = 0;
+  float acmrSource = 0.0f; // average cache misses per triangle, 3 is the worst case
+  float acmrWelded = 0.0f;
+  float acmrOptimized = 0.0f;
+};
+
+// Merges vertices with identical position, UV and color and rewrites indices to match
+void weldVertices(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+// Forsyth's linear-speed vertex cache optimisation, reorders the triangles in [indexBegin, indexEnd)
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t indexBegin, size_t indexEnd, size_t vertexCount);
+
+// Renumbers vertices in order of first use so vertex fetch walks memory forwards, drops unused vertices
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+float computeAcmr(const std::vector<uint32_t> &indices, size_t vertexCount, int cacheSize = ACMR_CACHE_SIZE);
+
+// Loads couch1.obj and testMap.obj and prints unique vertex ratio and ACMR before and after optimisation
+void runMeshOptimizationReport(Renderer &renderer);
@@ -0,0 +1,144 @@
+#include "meshRegistry.hpp"
+#include "bufferManager.hpp"
+#include "renderer.hpp"
+#include <cstdio>
+
+std::string MeshRegistry::contentKey(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+{
+  // FNV-1a over the vertex fields, skipping the padding inside Vertex
+  uint64_t hash = 14695981039346656037ull;
+  auto hashBytes = [&hash](const void *data, size_t size)
+  {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+    }
+  };
+
+  for (const Vertex &vertex : vertices)
+  {
+    hashBytes(&vertex.pos, sizeof(vertex.pos));
+    hashBytes(&vertex.color, sizeof(vertex.color));
+    hashBytes(&vertex.texPos, sizeof(vertex.texPos));
+  }
+  hashBytes(indices.data(), indices.size() * sizeof(uint32_t));
+
+  char key[32];
+  std::snprintf(key, sizeof(key), "hash:%016llx", static_cast<unsigned long long>(hash));
+  return key;
+}
+
+MeshHandle MeshRegistry::acquire(const std::string &key, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue)
+{
+  auto existing = handlesByKey.find(key);
+  if (existing != handlesByKey.end())
+  {
+    meshes[existing->second].refCount++;
+    return existing->second;
+  }
+
+  MeshHandle handle;
+  if (!freeHandles.empty())
+  {
+    handle = freeHandles.back();
+    freeHandles.pop_back();
+  }
+  else
+  {
+    handle = static_cast<MeshHandle>(meshes.size());
+    meshes.emplace_back();
+  }
+
+  GpuMesh &mesh = meshes[handle];
+  mesh.key = key;
+  mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+  mesh.indexCount = static_cast<uint32_t>(indices.size());
+  mesh.refCount = 1;
+  renderer.bufferManager.createVertexBuffer(vertices, mesh.vertexBuffer, mesh.vertexBufferAllocation, device);
+
+  if (vertices.size() <= UINT16_MAX + 1)
+  {
+    std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+    mesh.indexType = VK_INDEX_TYPE_UINT16;
+    renderer.bufferManager.createIndexBuffer(shortIndices.data(), shortIndices.size() * sizeof(uint16_t), mesh.indexBuffer, mesh.indexBufferAllocation, device);
+  }
+  else
+  {
+    mesh.indexType = VK_INDEX_TYPE_UINT32;
+    renderer.bufferManager.createIndexBuffer(indices.data(), indices.size() * sizeof(uint32_t), mesh.indexBuffer, mesh.indexBufferAllocation, device);
+  }
+
+  handlesByKey[key] = handle;
+  return handle;
+}
+
+void MeshRegistry::release(MeshHandle handle, VkDevice device)
+{
+  if (handle < 0 || handle >= static_cast<MeshHandle>(meshes.size()) || meshes[handle].refCount == 0)
+  {
+    return;
+  }
+
+  GpuMesh &mesh = meshes[handle];
+  if (--mesh.refCount > 0)
+  {
+    return;
+  }
+
+  handlesByKey.erase(mesh.key);
+  GpuMesh retired = mesh;
+  mesh = GpuMesh{};
+
+  // draws in flight may still read the buffers, and the slot is only handed out again once they are gone
+  renderer.destroyAfterFrames([this, handle, retired, device]() mutable
+                              {
+    destroyMesh(retired, device);
+    freeHandles.push_back(handle); });
+}
+
+MeshMemoryStats MeshRegistry::stats() const
+{
+  MeshMemoryStats stats;
+  for (const GpuMesh &mesh : meshes)
+  {
+    if (mesh.refCount == 0)
+    {
+      continue;
+    }
+
+    size_t bytes = mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * (mesh.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+    stats.meshCount++;
+    stats.references += mesh.refCount;
+    stats.gpuBytes += bytes;
+    stats.unsharedGpuBytes += bytes * mesh.refCount;
+  }
+  return stats;
+}
+
+void MeshRegistry::cleanup(VkDevice device)
+{
+  for (GpuMesh &mesh : meshes)
+  {
+    destroyMesh(mesh, device);
+  }
+  meshes.clear();
+  freeHandles.clear();
+  handlesByKey.clear();
+}
+
+void MeshRegistry::destroyMesh(GpuMesh &mesh, VkDevice device)
+{
+  if (mesh.vertexBuffer != VK_NULL_HANDLE)
+  {
+    vkDestroyBuffer(device, mesh.vertexBuffer, nullptr);
+    renderer.bufferManager.allocator.free(mesh.vertexBufferAllocation);
+  }
+  if (mesh.indexBuffer != VK_NULL_HANDLE)
+  {
+    vkDestroyBuffer(device, mesh.indexBuffer, nullptr);
+    renderer.bufferManager.allocator.free(mesh.indexBufferAllocation);
+  }
+  mesh = GpuMesh{};
+}
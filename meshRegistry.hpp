@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "vertex.h"
+#include "gpuAllocator.hpp"
+
+class Renderer;
+
+using MeshHandle = int;
+const MeshHandle INVALID_MESH = -1;
+
+struct GpuMesh
+{
+  std::string key;
+  VkBuffer vertexBuffer = VK_NULL_HANDLE;
+  GpuAllocation vertexBufferAllocation;
+  VkBuffer indexBuffer = VK_NULL_HANDLE;
+  GpuAllocation indexBufferAllocation;
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT32; // 16-bit whenever every vertex is addressable with it
+  int refCount = 0; // 0 marks a free slot
+};
+
+struct MeshMemoryStats
+{
+  size_t meshCount = 0;
+  size_t references = 0;
+  size_t gpuBytes = 0;         // what the registry holds
+  size_t unsharedGpuBytes = 0; // what one copy per reference would take
+};
+
+// Uploads every distinct mesh once and hands out refcounted handles to it. Meshes loaded from a
+// file are keyed by path, everything else by a hash of its vertex and index data.
+class MeshRegistry
+{
+public:
+  MeshRegistry(Renderer &renderer) : renderer(renderer)
+  {
+  }
+
+  static std::string contentKey(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+
+  // Returns the existing mesh for key with one more reference, or uploads vertices and indices under it
+  MeshHandle acquire(const std::string &key, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
+  // Drops one reference. The last one frees the buffers once the frames already submitted are done with them.
+  void release(MeshHandle handle, VkDevice device);
+  const GpuMesh &get(MeshHandle handle) const { return meshes[handle]; }
+
+  MeshMemoryStats stats() const;
+  void cleanup(VkDevice device);
+
+private:
+  Renderer &renderer;
+  std::vector<GpuMesh> meshes;
+  std::vector<MeshHandle> freeHandles;
+  std::unordered_map<std::string, MeshHandle> handlesByKey;
+
+  void destroyMesh(GpuMesh &mesh, VkDevice device);
+};
@@ -0,0 +1,263 @@
+#include "physicsBenchmark.hpp"
+#include "renderer.hpp"
+#include "gameObject.hpp"
+#include "gameObjectPhysicsConfig.hpp"
+#include "physicsBroadphase.hpp"
+#include "physicsProfiler.hpp"
+#include <btBulletDynamicsCommon.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#define BENCHMARK_WARMUP_STEPS 60
+#define BENCHMARK_STEPS 600
+#define LOD_BENCHMARK_AREA 400.0f
+#define BROADPHASE_BENCHMARK_AREA 300.0f
+
+// Empty world with gravity and a ground plane at y = 0.
+struct BenchmarkWorld
+{
+  btBroadphaseInterface *broadphase;
+  btDefaultCollisionConfiguration collisionConfiguration;
+  btCollisionDispatcher dispatcher;
+  btSequentialImpulseConstraintSolver solver;
+  btDiscreteDynamicsWorld *dynamicsWorld;
+
+  btStaticPlaneShape groundShape;
+  btRigidBody ground;
+
+  BenchmarkWorld(const BroadphaseSettings &broadphaseSettings = BroadphaseSettings()) : dispatcher(&collisionConfiguration), groundShape(btVector3(0, 1, 0), 0), ground(btRigidBody::btRigidBodyConstructionInfo(0, nullptr, &groundShape))
+  {
+    broadphase = createBroadphase(broadphaseSettings, btVector3(-250, -10, -250), btVector3(250, 200, 250));
+    dynamicsWorld = new btDiscreteDynamicsWorld(&dispatcher, broadphase, &solver, &collisionConfiguration);
+    dynamicsWorld->setGravity(btVector3(0, -20.f, 0));
+    dynamicsWorld->addRigidBody(&ground, StaticWorldGroup, AllGroups);
+  }
+
+  ~BenchmarkWorld()
+  {
+    dynamicsWorld->removeRigidBody(&ground);
+    delete dynamicsWorld;
+    delete broadphase;
+  }
+};
+
+static float benchmarkCouches(Renderer &renderer, ColliderType collider, int couchCount)
+{
+  BenchmarkWorld world;
+  btDiscreteDynamicsWorld *dynamicsWorld = world.dynamicsWorld;
+
+  PhysicsConfig config;
+  config.collider = collider;
+  config.isRigidBody = true;
+  config.mass = 74;
+
+  GameObject prototype(renderer, 0, config, glm::vec3(0), glm::vec3(0.1, 0.1, 0.1), glm::vec3(10, 40, 50), {}, {});
+  prototype.loadModel("models/couch/couch1.obj");
+
+  // stack the couches in a loose grid so they fall onto each other and keep colliding
+  std::vector<GameObject> couches;
+  couches.reserve(couchCount);
+  for (int i = 0; i < couchCount; i++)
+  {
+    couches.push_back(prototype);
+    couches.back().id = i;
+    couches.back().pos = glm::vec3((i % 4) * 3.0f, 5.0f + (i / 16) * 4.0f, ((i / 4) % 4) * 3.0f);
+    couches.back().initPhysics(dynamicsWorld);
+  }
+
+  for (int i = 0; i < BENCHMARK_WARMUP_STEPS; i++)
+  {
+    dynamicsWorld->stepSimulation(1.0f / 60.0f, 0);
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < BENCHMARK_STEPS; i++)
+  {
+    dynamicsWorld->stepSimulation(1.0f / 60.0f, 0);
+  }
+  std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+  for (auto &couch : couches)
+  {
+    couch.cleanupPhysics(dynamicsWorld);
+  }
+
+  return elapsed.count() / BENCHMARK_STEPS;
+}
+
+void runColliderBenchmark(Renderer &renderer, int couchCount)
+{
+  std::cout << "Collider benchmark: " << couchCount << " couches, " << BENCHMARK_STEPS << " steps" << std::endl;
+
+  std::cout << "Mesh: " << benchmarkCouches(renderer, ColliderType::Mesh, couchCount) << " ms/step" << std::endl;
+  std::cout << "ConvexHull: " << benchmarkCouches(renderer, ColliderType::ConvexHull, couchCount) << " ms/step" << std::endl;
+  std::cout << "ConvexDecomposition: " << benchmarkCouches(renderer, ColliderType::ConvexDecomposition, couchCount) << " ms/step" << std::endl;
+}
+
+static void benchmarkLod(Renderer &renderer, int propCount, const PhysicsLodSettings &settings, const std::string &label)
+{
+  BenchmarkWorld world;
+  btDiscreteDynamicsWorld *dynamicsWorld = world.dynamicsWorld;
+
+  PhysicsConfig config;
+  config.collider = ColliderType::Box;
+  config.isRigidBody = true;
+  config.mass = 1;
+  config.boxColliderSize = glm::vec3(0.5, 0.5, 0.5);
+
+  GameObject prototype(renderer, 0, config, glm::vec3(0), glm::vec3(1), glm::vec3(0), {}, {});
+
+  // fixed seed so every radius sees the same scene, staggered heights keep props landing for a while
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> horizontal(-LOD_BENCHMARK_AREA / 2, LOD_BENCHMARK_AREA / 2);
+  std::uniform_real_distribution<float> height(2.0f, 80.0f);
+
+  std::vector<GameObject> props;
+  props.reserve(propCount);
+  for (int i = 0; i < propCount; i++)
+  {
+    props.push_back(prototype);
+    props.back().id = i;
+    props.back().pos = glm::vec3(horizontal(random), height(random), horizontal(random));
+    props.back().initPhysics(dynamicsWorld);
+  }
+
+  const std::vector<glm::vec3> playerPositions = {glm::vec3(0, 0, 0)};
+
+  float totalMs = 0;
+  long activeBodies = 0;
+  for (int i = 0; i < BENCHMARK_WARMUP_STEPS + BENCHMARK_STEPS; i++)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (auto &prop : props)
+    {
+      applyPhysicsLod(prop, playerPositions, settings);
+    }
+    dynamicsWorld->stepSimulation(1.0f / 60.0f, 0);
+    for (auto &prop : props)
+    {
+      prop.updatePhysics();
+    }
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    if (i < BENCHMARK_WARMUP_STEPS)
+    {
+      continue;
+    }
+
+    totalMs += elapsed.count();
+    for (auto &prop : props)
+    {
+      activeBodies += prop.rigidBody->isActive() ? 1 : 0;
+    }
+  }
+
+  for (auto &prop : props)
+  {
+    prop.cleanupPhysics(dynamicsWorld);
+  }
+
+  std::cout << label << ": " << totalMs / BENCHMARK_STEPS << " ms/step, " << static_cast<float>(activeBodies) / BENCHMARK_STEPS << " active bodies" << std::endl;
+}
+
+void runLodBenchmark(Renderer &renderer, int propCount)
+{
+  std::cout << "Physics LOD benchmark: " << propCount << " props over " << LOD_BENCHMARK_AREA << "x" << LOD_BENCHMARK_AREA << ", " << BENCHMARK_STEPS << " steps" << std::endl;
+
+  PhysicsLodSettings settings;
+  settings.enabled = false;
+  benchmarkLod(renderer, propCount, settings, "LOD off");
+
+  settings.enabled = true;
+  for (float radius : {160.0f, 80.0f, 40.0f, 20.0f})
+  {
+    settings.farRadius = radius;
+    settings.midRadius = radius / 2;
+    settings.freezeFarBodies = false;
+    benchmarkLod(renderer, propCount, settings, "far radius " + std::to_string(static_cast<int>(radius)));
+
+    settings.freezeFarBodies = true;
+    benchmarkLod(renderer, propCount, settings, "far radius " + std::to_string(static_cast<int>(radius)) + " frozen");
+  }
+}
+
+static void benchmarkBroadphase(Renderer &renderer, BroadphaseType type, int staticCount, int dynamicCount)
+{
+  BroadphaseSettings settings;
+  settings.type = type;
+  BenchmarkWorld world(settings);
+  btDiscreteDynamicsWorld *dynamicsWorld = world.dynamicsWorld;
+
+  PhysicsConfig staticConfig;
+  staticConfig.collider = ColliderType::Box;
+  staticConfig.isRigidBody = true;
+  staticConfig.canMove = false;
+  staticConfig.mass = 0;
+  staticConfig.boxColliderSize = glm::vec3(1, 2, 1);
+
+  PhysicsConfig dynamicConfig;
+  dynamicConfig.collider = ColliderType::Box;
+  dynamicConfig.isRigidBody = true;
+  dynamicConfig.mass = 1;
+  dynamicConfig.boxColliderSize = glm::vec3(0.5, 0.5, 0.5);
+
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> horizontal(-BROADPHASE_BENCHMARK_AREA / 2, BROADPHASE_BENCHMARK_AREA / 2);
+  std::uniform_real_distribution<float> height(2.0f, 150.0f);
+
+  std::vector<GameObject> objects;
+  objects.reserve(staticCount + dynamicCount);
+  for (int i = 0; i < staticCount + dynamicCount; i++)
+  {
+    bool isStatic = i < staticCount;
+    objects.emplace_back(renderer, i, isStatic ? staticConfig : dynamicConfig, glm::vec3(0), glm::vec3(1), glm::vec3(0), std::vector<Vertex>(), std::vector<uint32_t>());
+    objects.back().pos = glm::vec3(horizontal(random), isStatic ? 2.0f : height(random), horizontal(random));
+    objects.back().initPhysics(dynamicsWorld);
+
+    // moving proxies are what the broadphase pays for, so keep them awake for the whole run
+    if (!isStatic)
+    {
+      objects.back().rigidBody->setActivationState(DISABLE_DEACTIVATION);
+    }
+  }
+
+  PhysicsProfiler profiler;
+  float stepMs = 0;
+  float broadphaseMs = 0;
+  for (int i = 0; i < BENCHMARK_WARMUP_STEPS + BENCHMARK_STEPS; i++)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    dynamicsWorld->stepSimulation(1.0f / 60.0f, 0);
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    profiler.endStep(dynamicsWorld, elapsed.count());
+
+    if (i >= BENCHMARK_WARMUP_STEPS)
+    {
+      stepMs += profiler.last.stepMs;
+      broadphaseMs += profiler.last.broadphaseMs;
+    }
+  }
+
+  std::cout << "  " << broadphaseName(type) << ": " << stepMs / BENCHMARK_STEPS << " ms/step, " << broadphaseMs / BENCHMARK_STEPS << " ms broadphase, "
+            << profiler.last.overlappingPairs << " pairs" << std::endl;
+
+  for (auto &object : objects)
+  {
+    object.cleanupPhysics(dynamicsWorld);
+  }
+}
+
+void runBroadphaseBenchmark(Renderer &renderer, int objectCount)
+{
+  std::cout << "Broadphase benchmark: " << objectCount << " objects, " << BENCHMARK_STEPS << " steps" << std::endl;
+
+  std::cout << "Static heavy (" << objectCount << " static, " << objectCount / 10 << " dynamic)" << std::endl;
+  benchmarkBroadphase(renderer, BroadphaseType::Dbvt, objectCount, objectCount / 10);
+  benchmarkBroadphase(renderer, BroadphaseType::AxisSweep, objectCount, objectCount / 10);
+
+  std::cout << "Dynamic heavy (" << objectCount / 10 << " static, " << objectCount << " dynamic)" << std::endl;
+  benchmarkBroadphase(renderer, BroadphaseType::Dbvt, objectCount / 10, objectCount);
+  benchmarkBroadphase(renderer, BroadphaseType::AxisSweep, objectCount / 10, objectCount);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+class Renderer;
+
+void runColliderBenchmark(Renderer &renderer, int couchCount);
+void runLodBenchmark(Renderer &renderer, int propCount);
+void runBroadphaseBenchmark(Renderer &renderer, int objectCount);
@@ -0,0 +1,29 @@
+#include "physicsBroadphase.hpp"
+#include <BulletCollision/BroadphaseCollision/btAxisSweep3.h>
+
+btBroadphaseInterface *createBroadphase(const BroadphaseSettings &settings, const btVector3 &worldMin, const btVector3 &worldMax)
+{
+  switch (settings.type)
+  {
+  case BroadphaseType::AxisSweep:
+  {
+    btVector3 padding(settings.boundsPadding, settings.boundsPadding, settings.boundsPadding);
+    return new bt32BitAxisSweep3(worldMin - padding, worldMax + padding, settings.maxProxies);
+  }
+  case BroadphaseType::Dbvt:
+  default:
+    return new btDbvtBroadphase();
+  }
+}
+
+const char *broadphaseName(BroadphaseType type)
+{
+  switch (type)
+  {
+  case BroadphaseType::AxisSweep:
+    return "AxisSweep";
+  case BroadphaseType::Dbvt:
+  default:
+    return "Dbvt";
+  }
+}
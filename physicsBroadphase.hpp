@@ -0,0 +1,21 @@
+#pragma once
+#include <btBulletDynamicsCommon.h>
+
+enum class BroadphaseType
+{
+  Dbvt,     // dynamic AABB trees, keeps static and moving proxies in separate trees
+  AxisSweep // bt32BitAxisSweep3, sweep and prune inside fixed world bounds
+};
+
+struct BroadphaseSettings
+{
+  BroadphaseType type = BroadphaseType::Dbvt;
+  float boundsPadding = 50.0f; // added around the static geometry so props and players stay inside
+  unsigned int maxProxies = 16384;
+};
+
+// worldMin/worldMax are only used by AxisSweep. Proxies outside them still work but all land in the
+// edge cells, so the bounds should cover everything that moves.
+btBroadphaseInterface *createBroadphase(const BroadphaseSettings &settings, const btVector3 &worldMin, const btVector3 &worldMax);
+
+const char *broadphaseName(BroadphaseType type);
@@ -0,0 +1,74 @@
+#include "physicsLod.hpp"
+#include "gameObject.hpp"
+#include <algorithm>
+#include <limits>
+
+static PhysicsLodLevel pickLevel(const glm::vec3 &position, const std::vector<glm::vec3> &playerPositions, const PhysicsLodSettings &settings)
+{
+  if (!settings.enabled || playerPositions.empty())
+  {
+    return PhysicsLodLevel::Near;
+  }
+
+  float closestDistance2 = std::numeric_limits<float>::max();
+  for (const glm::vec3 &playerPosition : playerPositions)
+  {
+    glm::vec3 offset = position - playerPosition;
+    closestDistance2 = std::min(closestDistance2, glm::dot(offset, offset));
+  }
+
+  if (closestDistance2 >= settings.farRadius * settings.farRadius)
+  {
+    return PhysicsLodLevel::Far;
+  }
+  if (closestDistance2 >= settings.midRadius * settings.midRadius)
+  {
+    return PhysicsLodLevel::Mid;
+  }
+  return PhysicsLodLevel::Near;
+}
+
+void applyPhysicsLod(GameObject &gameObject, const std::vector<glm::vec3> &playerPositions, const PhysicsLodSettings &settings)
+{
+  btRigidBody *rigidBody = gameObject.rigidBody;
+  if (!rigidBody || rigidBody->isStaticOrKinematicObject())
+  {
+    return;
+  }
+
+  PhysicsLodLevel level = pickLevel(gameObject.physicsPos, playerPositions, settings);
+
+  if (level == PhysicsLodLevel::Far && settings.freezeFarBodies && rigidBody->isActive())
+  {
+    rigidBody->setActivationState(ISLAND_SLEEPING);
+  }
+
+  if (level == gameObject.physicsLodLevel)
+  {
+    return;
+  }
+
+  switch (level)
+  {
+  case PhysicsLodLevel::Near:
+    rigidBody->setSleepingThresholds(settings.linearSleepingThreshold, settings.angularSleepingThreshold);
+    gameObject.setPhysicsSyncInterval(1);
+    break;
+  case PhysicsLodLevel::Mid:
+    rigidBody->setSleepingThresholds(settings.linearSleepingThreshold, settings.angularSleepingThreshold);
+    gameObject.setPhysicsSyncInterval(settings.midSyncInterval);
+    break;
+  case PhysicsLodLevel::Far:
+    rigidBody->setSleepingThresholds(settings.farLinearSleepingThreshold, settings.farAngularSleepingThreshold);
+    gameObject.setPhysicsSyncInterval(settings.farSyncInterval);
+    break;
+  }
+
+  // a frozen body has to wake up once a player gets close enough again
+  if (gameObject.physicsLodLevel == PhysicsLodLevel::Far && settings.freezeFarBodies)
+  {
+    rigidBody->activate();
+  }
+
+  gameObject.physicsLodLevel = level;
+}
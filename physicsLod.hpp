@@ -0,0 +1,36 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+class GameObject;
+
+enum class PhysicsLodLevel
+{
+  Near,
+  Mid,
+  Far
+};
+
+// Distance based level of detail for dynamic rigid bodies, measured to the closest player.
+// Mid bodies sync their visual transform less often. Far bodies also use aggressive sleeping
+// thresholds, and can optionally be frozen so they skip every substep until a player comes closer.
+struct PhysicsLodSettings
+{
+  bool enabled = true;
+  float midRadius = 40.0f;
+  float farRadius = 80.0f;
+
+  int midSyncInterval = 2; // steps between reading the motion state, the visual transform is interpolated in between
+  int farSyncInterval = 4;
+
+  float linearSleepingThreshold = 0.8f; // Bullet's defaults, used by Near and Mid
+  float angularSleepingThreshold = 1.0f;
+  float farLinearSleepingThreshold = 2.5f;
+  float farAngularSleepingThreshold = 2.5f;
+
+  bool freezeFarBodies = false; // sleep far bodies right away, even mid-air; contacts with awake bodies still wake them
+};
+
+// Picks the level for one object and applies thresholds and sync interval when the level changes.
+// Does nothing for objects without a dynamic rigid body.
+void applyPhysicsLod(GameObject &gameObject, const std::vector<glm::vec3> &playerPositions, const PhysicsLodSettings &settings);
@@ -0,0 +1,173 @@
+#include "physicsProfiler.hpp"
+#include <LinearMath/btQuickprof.h>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+#ifndef BT_NO_PROFILE
+// Node names are the BT_PROFILE labels inside btDiscreteDynamicsWorld plus the ones in our own code.
+static void addProfileTime(const char *name, float time, PhysicsStepStats &stats)
+{
+  if (strcmp(name, "updateAabbs") == 0 || strcmp(name, "calculateOverlappingPairs") == 0)
+    stats.broadphaseMs += time;
+  else if (strcmp(name, "dispatchAllCollisionPairs") == 0)
+    stats.narrowphaseMs += time;
+  else if (strcmp(name, "solveConstraints") == 0)
+    stats.solverMs += time;
+  else if (strcmp(name, "integrateTransforms") == 0 || strcmp(name, "predictUnconstraintMotion") == 0)
+    stats.integrationMs += time;
+  else if (strcmp(name, "CharacterController::update") == 0)
+    stats.characterMs += time;
+  else if (strcmp(name, "RayBatch::run") == 0)
+    stats.queryMs += time;
+}
+
+static void walkProfileTree(CProfileIterator *iterator, PhysicsStepStats &stats)
+{
+  int childCount = 0;
+  for (iterator->First(); !iterator->Is_Done(); iterator->Next())
+  {
+    addProfileTime(iterator->Get_Current_Name(), iterator->Get_Current_Total_Time(), stats);
+    childCount++;
+  }
+
+  for (int i = 0; i < childCount; i++)
+  {
+    iterator->Enter_Child(i);
+    walkProfileTree(iterator, stats);
+    iterator->Enter_Parent();
+  }
+}
+#endif
+
+bool PhysicsProfiler::openCsv(const std::string &path)
+{
+  csv.open(path, std::ios::trunc);
+  if (!csv.is_open())
+  {
+    std::cerr << "Failed to open physics CSV: " << path << std::endl;
+    return false;
+  }
+
+  csv << "step,stepMs,broadphaseMs,narrowphaseMs,solverMs,integrationMs,characterMs,queryMs,"
+      << "collisionObjects,activeBodies,sleepingBodies,islands,overlappingPairs,contactManifolds\n";
+  return true;
+}
+
+void PhysicsProfiler::endStep(btDiscreteDynamicsWorld *dynamicsWorld, float stepMs)
+{
+  PhysicsStepStats stats;
+  stats.stepMs = stepMs;
+  collectProfileTimes(stats);
+  collectWorldStats(dynamicsWorld, stats);
+
+  last = stats;
+  window.push_back(stats);
+  if (window.size() > PHYSICS_PROFILER_WINDOW)
+  {
+    window.pop_front();
+  }
+
+  if (csv.is_open())
+  {
+    csv << stepIndex << ',' << stats.stepMs << ',' << stats.broadphaseMs << ',' << stats.narrowphaseMs << ','
+        << stats.solverMs << ',' << stats.integrationMs << ',' << stats.characterMs << ',' << stats.queryMs << ','
+        << stats.collisionObjects << ',' << stats.activeBodies << ',' << stats.sleepingBodies << ','
+        << stats.islands << ',' << stats.overlappingPairs << ',' << stats.contactManifolds << '\n';
+  }
+  stepIndex++;
+}
+
+void PhysicsProfiler::collectProfileTimes(PhysicsStepStats &stats)
+{
+#ifndef BT_NO_PROFILE
+  CProfileIterator *iterator = CProfileManager::Get_Iterator();
+  walkProfileTree(iterator, stats);
+  CProfileManager::Release_Iterator(iterator);
+#endif
+}
+
+void PhysicsProfiler::collectWorldStats(btDiscreteDynamicsWorld *dynamicsWorld, PhysicsStepStats &stats)
+{
+  std::unordered_set<int> islandTags;
+
+  const btCollisionObjectArray &collisionObjects = dynamicsWorld->getCollisionObjectArray();
+  stats.collisionObjects = collisionObjects.size();
+  for (int i = 0; i < collisionObjects.size(); i++)
+  {
+    const btCollisionObject *collisionObject = collisionObjects[i];
+    if (collisionObject->isStaticOrKinematicObject())
+    {
+      continue;
+    }
+
+    if (collisionObject->getActivationState() == ISLAND_SLEEPING)
+    {
+      stats.sleepingBodies++;
+    }
+    else
+    {
+      stats.activeBodies++;
+    }
+
+    if (collisionObject->getIslandTag() >= 0)
+    {
+      islandTags.insert(collisionObject->getIslandTag());
+    }
+  }
+
+  stats.islands = static_cast<int>(islandTags.size());
+  stats.overlappingPairs = dynamicsWorld->getBroadphase()->getOverlappingPairCache()->getNumOverlappingPairs();
+  stats.contactManifolds = dynamicsWorld->getDispatcher()->getNumManifolds();
+}
+
+static float percentile(std::vector<float> &values, int percent)
+{
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, values.size() * percent / 100)];
+}
+
+void PhysicsProfiler::printSummary(std::ostream &out) const
+{
+  if (window.empty())
+  {
+    return;
+  }
+
+  const struct
+  {
+    const char *name;
+    float PhysicsStepStats::*field;
+  } timings[] = {
+      {"step", &PhysicsStepStats::stepMs},
+      {"broadphase", &PhysicsStepStats::broadphaseMs},
+      {"narrowphase", &PhysicsStepStats::narrowphaseMs},
+      {"solver", &PhysicsStepStats::solverMs},
+      {"integration", &PhysicsStepStats::integrationMs},
+      {"character", &PhysicsStepStats::characterMs},
+      {"queries", &PhysicsStepStats::queryMs}};
+
+  std::streamsize precision = out.precision();
+  out << "Physics over last " << window.size() << " steps (ms p50/p95/p99/max)" << std::endl;
+
+  std::vector<float> values;
+  values.reserve(window.size());
+  for (const auto &timing : timings)
+  {
+    values.clear();
+    for (const PhysicsStepStats &stats : window)
+    {
+      values.push_back(stats.*timing.field);
+    }
+
+    out << "  " << std::left << std::setw(12) << timing.name << std::right << std::fixed << std::setprecision(3)
+        << percentile(values, 50) << " / " << percentile(values, 95) << " / " << percentile(values, 99) << " / " << values.back()
+        << std::defaultfloat << std::setprecision(precision) << std::endl;
+  }
+
+  out << "  objects " << last.collisionObjects << ", active " << last.activeBodies << ", sleeping " << last.sleepingBodies
+      << ", islands " << last.islands << ", pairs " << last.overlappingPairs << ", manifolds " << last.contactManifolds << std::endl;
+}
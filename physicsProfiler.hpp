@@ -0,0 +1,51 @@
+#pragma once
+#include <btBulletDynamicsCommon.h>
+#include <deque>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+#define PHYSICS_PROFILER_WINDOW 300
+
+// Timings are in milliseconds. The phase timings come from Bullet's CProfileManager and stay 0 when
+// Bullet is built with BT_NO_PROFILE.
+struct PhysicsStepStats
+{
+  float stepMs = 0;
+  float broadphaseMs = 0;
+  float narrowphaseMs = 0;
+  float solverMs = 0;
+  float integrationMs = 0;
+  float characterMs = 0;
+  float queryMs = 0;
+
+  int collisionObjects = 0;
+  int activeBodies = 0;
+  int sleepingBodies = 0;
+  int islands = 0;
+  int overlappingPairs = 0;
+  int contactManifolds = 0;
+};
+
+// Collects one PhysicsStepStats per simulation step. Keeps a rolling window for percentile summaries
+// and optionally appends every step to a CSV file.
+class PhysicsProfiler
+{
+public:
+  PhysicsStepStats last;
+
+  bool openCsv(const std::string &path);
+
+  // Call after stepSimulation and our own queries, before the next step resets Bullet's profiler.
+  void endStep(btDiscreteDynamicsWorld *dynamicsWorld, float stepMs);
+
+  void printSummary(std::ostream &out) const;
+
+private:
+  std::deque<PhysicsStepStats> window;
+  std::ofstream csv;
+  long stepIndex = 0;
+
+  void collectProfileTimes(PhysicsStepStats &stats);
+  void collectWorldStats(btDiscreteDynamicsWorld *dynamicsWorld, PhysicsStepStats &stats);
+};
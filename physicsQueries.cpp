@@ -0,0 +1,225 @@
+#include "physicsQueries.hpp"
+#include <BulletCollision/CollisionShapes/btCollisionShape.h>
+#include <LinearMath/btAabbUtil2.h>
+#include <LinearMath/btQuickprof.h>
+#include <stdexcept>
+
+bool BatchedRayResult::needsCollision(btBroadphaseProxy *proxy0) const
+{
+  if (!btCollisionWorld::RayResultCallback::needsCollision(proxy0))
+  {
+    return false;
+  }
+
+  if (filter != nullptr && !filter(static_cast<const btCollisionObject *>(proxy0->m_clientObject)))
+  {
+    return false;
+  }
+
+  // both rayTest and RayBatch::run call rayTestSingle right after this passes
+  narrowphaseTests++;
+  return true;
+}
+
+btScalar BatchedRayResult::addSingleResult(btCollisionWorld::LocalRayResult &rayResult, bool normalInWorldSpace)
+{
+  m_closestHitFraction = rayResult.m_hitFraction;
+  m_collisionObject = rayResult.m_collisionObject;
+
+  if (normalInWorldSpace)
+  {
+    hitNormalWorld = rayResult.m_hitNormalLocal;
+  }
+  else
+  {
+    hitNormalWorld = m_collisionObject->getWorldTransform().getBasis() * rayResult.m_hitNormalLocal;
+  }
+  hitPointWorld.setInterpolate3(rayFromWorld, rayToWorld, rayResult.m_hitFraction);
+
+  return rayResult.m_hitFraction;
+}
+
+void RayBatch::clear()
+{
+  rayCount = 0;
+}
+
+int RayBatch::addRay(const btVector3 &from, const btVector3 &to, QueryFilter filter, int collisionMask)
+{
+  if (rayCount >= MAX_BATCHED_RAYS)
+  {
+    throw std::runtime_error("ray batch is full!");
+  }
+
+  BatchedRayResult &result = results[rayCount];
+  result.rayFromWorld = from;
+  result.rayToWorld = to;
+  result.filter = filter;
+  result.m_closestHitFraction = btScalar(1.);
+  result.m_collisionObject = nullptr;
+  result.narrowphaseTests = 0;
+  // queries belong to every group, so only their own mask decides what they visit
+  result.m_collisionFilterGroup = btBroadphaseProxy::AllFilter;
+  result.m_collisionFilterMask = collisionMask;
+
+  return rayCount++;
+}
+
+bool RayBatch::CandidateCollector::process(const btBroadphaseProxy *proxy)
+{
+  if ((proxy->m_collisionFilterGroup & batch->candidateMask) == 0)
+  {
+    return true;
+  }
+
+  if (batch->candidateCount >= MAX_BATCHED_CANDIDATES)
+  {
+    batch->candidatesOverflowed = true;
+    return false;
+  }
+
+  batch->candidates[batch->candidateCount++] = static_cast<btCollisionObject *>(proxy->m_clientObject);
+  return true;
+}
+
+void RayBatch::run(btCollisionWorld *collisionWorld)
+{
+  BT_PROFILE("RayBatch::run");
+
+  if (rayCount == 0)
+  {
+    return;
+  }
+  stats.rays += rayCount;
+
+  if (castSeparately)
+  {
+    castEachRay(collisionWorld);
+    return;
+  }
+
+  btVector3 batchMin = results[0].rayFromWorld;
+  btVector3 batchMax = results[0].rayFromWorld;
+  candidateMask = 0;
+  for (int i = 0; i < rayCount; i++)
+  {
+    candidateMask |= results[i].m_collisionFilterMask;
+    batchMin.setMin(results[i].rayFromWorld);
+    batchMin.setMin(results[i].rayToWorld);
+    batchMax.setMax(results[i].rayFromWorld);
+    batchMax.setMax(results[i].rayToWorld);
+  }
+
+  candidateCount = 0;
+  candidatesOverflowed = false;
+  CandidateCollector collector;
+  collector.batch = this;
+  collisionWorld->getBroadphase()->aabbTest(batchMin, batchMax, collector);
+  stats.traversals++;
+
+  if (candidatesOverflowed)
+  {
+    // too crowded for the fixed candidate list, fall back to one traversal per ray
+    castEachRay(collisionWorld);
+    return;
+  }
+
+  for (int i = 0; i < rayCount; i++)
+  {
+    BatchedRayResult &result = results[i];
+
+    btTransform rayFromTrans;
+    rayFromTrans.setIdentity();
+    rayFromTrans.setOrigin(result.rayFromWorld);
+    btTransform rayToTrans;
+    rayToTrans.setIdentity();
+    rayToTrans.setOrigin(result.rayToWorld);
+
+    btVector3 rayDirection = result.rayToWorld - result.rayFromWorld;
+    rayDirection.normalize();
+    btVector3 rayDirectionInverse(
+        rayDirection[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[0],
+        rayDirection[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[1],
+        rayDirection[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[2]);
+    unsigned int signs[3] = {rayDirectionInverse[0] < 0.0, rayDirectionInverse[1] < 0.0, rayDirectionInverse[2] < 0.0};
+    btScalar lambdaMax = rayDirection.dot(result.rayToWorld - result.rayFromWorld);
+
+    for (int c = 0; c < candidateCount; c++)
+    {
+      btCollisionObject *collisionObject = candidates[c];
+      btBroadphaseProxy *proxy = collisionObject->getBroadphaseHandle();
+      btVector3 bounds[2] = {proxy->m_aabbMin, proxy->m_aabbMax};
+      btScalar param = 1.0;
+      if (!btRayAabb2(result.rayFromWorld, rayDirectionInverse, signs, bounds, param, 0, lambdaMax))
+      {
+        continue;
+      }
+
+      if (!result.needsCollision(proxy))
+      {
+        continue;
+      }
+
+      btCollisionWorld::rayTestSingle(rayFromTrans, rayToTrans, collisionObject, collisionObject->getCollisionShape(), collisionObject->getWorldTransform(), result);
+    }
+  }
+
+  for (int i = 0; i < rayCount; i++)
+  {
+    stats.narrowphaseTests += results[i].narrowphaseTests;
+  }
+}
+
+void RayBatch::castEachRay(btCollisionWorld *collisionWorld)
+{
+  for (int i = 0; i < rayCount; i++)
+  {
+    collisionWorld->rayTest(results[i].rayFromWorld, results[i].rayToWorld, results[i]);
+    stats.traversals++;
+    stats.narrowphaseTests += results[i].narrowphaseTests;
+  }
+}
+
+struct ClosestNotMeConvexResultCallback : public btCollisionWorld::ClosestConvexResultCallback
+{
+  const btCollisionObject *me;
+
+  ClosestNotMeConvexResultCallback(const btCollisionObject *me, const btVector3 &from, const btVector3 &to) : btCollisionWorld::ClosestConvexResultCallback(from, to), me(me) {}
+
+  bool needsCollision(btBroadphaseProxy *proxy0) const override
+  {
+    const btCollisionObject *collisionObject = static_cast<const btCollisionObject *>(proxy0->m_clientObject);
+    if (collisionObject == me || !collisionObject->hasContactResponse())
+    {
+      return false;
+    }
+
+    return btCollisionWorld::ClosestConvexResultCallback::needsCollision(proxy0);
+  }
+};
+
+void sweepShape(btCollisionWorld *collisionWorld, const btConvexShape *shape, const btVector3 &from, const btVector3 &to, const btCollisionObject *ignoreObject, SweepResult &result,
+                int collisionMask)
+{
+  btTransform fromTransform;
+  fromTransform.setIdentity();
+  fromTransform.setOrigin(from);
+  btTransform toTransform;
+  toTransform.setIdentity();
+  toTransform.setOrigin(to);
+
+  ClosestNotMeConvexResultCallback callback(ignoreObject, from, to);
+  if (ignoreObject && ignoreObject->getBroadphaseHandle())
+  {
+    callback.m_collisionFilterGroup = ignoreObject->getBroadphaseHandle()->m_collisionFilterGroup;
+    callback.m_collisionFilterMask = ignoreObject->getBroadphaseHandle()->m_collisionFilterMask;
+  }
+  callback.m_collisionFilterMask &= collisionMask;
+  collisionWorld->convexSweepTest(shape, fromTransform, toTransform, callback);
+
+  result.hasHit = callback.hasHit();
+  result.hitFraction = callback.m_closestHitFraction;
+  result.hitNormalWorld = callback.m_hitNormalWorld;
+  result.hitPointWorld = callback.m_hitPointWorld;
+  result.collisionObject = callback.m_hitCollisionObject;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <btBulletDynamicsCommon.h>
+
+#define MAX_BATCHED_RAYS 32
+#define MAX_BATCHED_CANDIDATES 256
+
+typedef bool (*QueryFilter)(const btCollisionObject *collisionObject);
+
+struct BatchedRayResult : public btCollisionWorld::RayResultCallback
+{
+  btVector3 rayFromWorld;
+  btVector3 rayToWorld;
+  btVector3 hitNormalWorld;
+  btVector3 hitPointWorld;
+  QueryFilter filter = nullptr;
+  mutable int narrowphaseTests = 0; // objects that passed the filters since the ray was added
+
+  bool needsCollision(btBroadphaseProxy *proxy0) const override;
+  btScalar addSingleResult(btCollisionWorld::LocalRayResult &rayResult, bool normalInWorldSpace) override;
+};
+
+struct RayBatchStats
+{
+  long long rays = 0;
+  long long traversals = 0;       // broadphase walks, one per ray when the rays are cast separately
+  long long narrowphaseTests = 0; // rayTestSingle calls
+};
+
+// Casts up to MAX_BATCHED_RAYS rays with a single broadphase traversal over their combined bounds.
+// Every ray keeps the closest hit that passes its filter, same as a ClosestRayResultCallback would.
+class RayBatch
+{
+public:
+  BatchedRayResult results[MAX_BATCHED_RAYS];
+  int rayCount = 0;
+  bool castSeparately = false; // one rayTest per ray like before batching, used to check the batch against it
+  RayBatchStats stats;         // totals over every run
+
+  void clear();
+  int addRay(const btVector3 &from, const btVector3 &to, QueryFilter filter = nullptr, int collisionMask = btBroadphaseProxy::AllFilter);
+  void run(btCollisionWorld *collisionWorld);
+
+private:
+  btCollisionObject *candidates[MAX_BATCHED_CANDIDATES];
+  int candidateCount = 0;
+  int candidateMask = 0; // union of the ray masks, proxies outside it are never collected
+  bool candidatesOverflowed = false;
+
+  void castEachRay(btCollisionWorld *collisionWorld);
+
+  struct CandidateCollector : public btBroadphaseAabbCallback
+  {
+    RayBatch *batch;
+    bool process(const btBroadphaseProxy *proxy) override;
+  };
+};
+
+struct SweepResult
+{
+  bool hasHit = false;
+  btScalar hitFraction = 1;
+  btVector3 hitNormalWorld;
+  btVector3 hitPointWorld;
+  const btCollisionObject *collisionObject = nullptr;
+};
+
+// Sweeps a convex shape (e.g. a character capsule) from one position to another, ignoring ignoreObject
+// and objects without contact response. Uses ignoreObject's collision group and mask when it has them,
+// narrowed down to collisionMask.
+void sweepShape(btCollisionWorld *collisionWorld, const btConvexShape *shape, const btVector3 &from, const btVector3 &to, const btCollisionObject *ignoreObject, SweepResult &result,
+                int collisionMask = btBroadphaseProxy::AllFilter);
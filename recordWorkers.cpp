@@ -0,0 +1,177 @@
+#include "recordWorkers.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+void RecordWorkers::init(VkDevice device, uint32_t queueFamily, int framesInFlight, size_t threadCount)
+{
+  slices.resize(std::max(threadCount, static_cast<size_t>(1)));
+  for (Slice &slice : slices)
+  {
+    slice.commandPools.resize(framesInFlight);
+    slice.commandBuffers.resize(framesInFlight);
+    for (int frame = 0; frame < framesInFlight; frame++)
+    {
+      // buffers are never reset on their own, the whole pool is once per frame
+      VkCommandPoolCreateInfo poolInfo{};
+      poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+      poolInfo.queueFamilyIndex = queueFamily;
+      if (vkCreateCommandPool(device, &poolInfo, nullptr, &slice.commandPools[frame]) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create record command pool!");
+      }
+
+      VkCommandBufferAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.commandPool = slice.commandPools[frame];
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      allocInfo.commandBufferCount = 1;
+      if (vkAllocateCommandBuffers(device, &allocInfo, &slice.commandBuffers[frame]) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to allocate secondary command buffer!");
+      }
+    }
+  }
+
+  for (size_t slice = 1; slice < slices.size(); slice++)
+  {
+    threads.emplace_back(&RecordWorkers::threadLoop, this, slice);
+  }
+}
+
+void RecordWorkers::cleanup(VkDevice device)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads)
+  {
+    thread.join();
+  }
+  threads.clear();
+
+  // destroying a pool frees its buffers
+  for (Slice &slice : slices)
+  {
+    for (VkCommandPool commandPool : slice.commandPools)
+    {
+      vkDestroyCommandPool(device, commandPool, nullptr);
+    }
+  }
+  slices.clear();
+}
+
+size_t RecordWorkers::sliceCount(size_t count, size_t minPerSlice, size_t maxSlices) const
+{
+  size_t limit = std::min(maxSlices == 0 ? slices.size() : maxSlices, slices.size());
+  return std::clamp(count / std::max(minPerSlice, static_cast<size_t>(1)), static_cast<size_t>(1), std::max(limit, static_cast<size_t>(1)));
+}
+
+void RecordWorkers::run(size_t sliceCount, const std::function<void(size_t)> &work)
+{
+  sliceCount = std::clamp(sliceCount, static_cast<size_t>(1), slices.size());
+  if (sliceCount > 1)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = &work;
+      jobSlices = sliceCount;
+      remaining = sliceCount - 1;
+      generation++;
+    }
+    wake.notify_all();
+  }
+
+  try
+  {
+    work(0);
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error)
+    {
+      error = std::current_exception();
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [this]()
+                { return remaining == 0; });
+  job = nullptr;
+  if (error)
+  {
+    std::exception_ptr thrown = error;
+    error = nullptr;
+    std::rethrow_exception(thrown);
+  }
+}
+
+VkCommandBuffer RecordWorkers::beginSecondary(VkDevice device, size_t slice, uint32_t frame, VkRenderPass renderPass, VkFramebuffer framebuffer)
+{
+  vkResetCommandPool(device, slices[slice].commandPools[frame], 0);
+  VkCommandBuffer commandBuffer = slices[slice].commandBuffers[frame];
+
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = renderPass;
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = framebuffer;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to begin recording secondary command buffer!");
+  }
+  return commandBuffer;
+}
+
+void RecordWorkers::threadLoop(size_t slice)
+{
+  uint64_t seen = 0;
+  while (true)
+  {
+    const std::function<void(size_t)> *work = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this, seen]()
+                { return stopping || generation != seen; });
+      if (stopping)
+      {
+        return;
+      }
+      seen = generation;
+      if (slice >= jobSlices)
+      {
+        continue;
+      }
+      work = job;
+    }
+
+    std::exception_ptr thrown;
+    try
+    {
+      (*work)(slice);
+    }
+    catch (...)
+    {
+      thrown = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (thrown && !error)
+      {
+        error = thrown;
+      }
+      remaining--;
+    }
+    finished.notify_one();
+  }
+}
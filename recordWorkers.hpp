@@ -0,0 +1,54 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+#define MIN_DRAWS_PER_SLICE 256 // below this a slice costs more to hand out than to record inline
+
+// A fixed set of threads that split frame recording between them. Every slice has its own command
+// pool per frame in flight, so secondary buffers are recorded without any locking and a pool is
+// reset as a whole once its frame's fence has signalled. Slice 0 always runs on the calling thread.
+class RecordWorkers
+{
+public:
+  void init(VkDevice device, uint32_t queueFamily, int framesInFlight, size_t threadCount);
+  void cleanup(VkDevice device); // joins the threads, the device must be idle
+
+  size_t threadCount() const { return slices.size(); }
+  // How many slices count items split into, none smaller than minPerSlice unless there is only one
+  size_t sliceCount(size_t count, size_t minPerSlice, size_t maxSlices) const;
+  static size_t sliceBegin(size_t count, size_t slices, size_t slice) { return count * slice / slices; }
+
+  // Runs job(slice) for every slice in parallel and returns once all of them are done. An exception
+  // thrown by any slice is rethrown here.
+  void run(size_t sliceCount, const std::function<void(size_t)> &job);
+
+  // Resets the slice's pool for frame and begins its secondary buffer inside the render pass
+  VkCommandBuffer beginSecondary(VkDevice device, size_t slice, uint32_t frame, VkRenderPass renderPass, VkFramebuffer framebuffer);
+
+private:
+  struct Slice
+  {
+    std::vector<VkCommandPool> commandPools; // one per frame in flight
+    std::vector<VkCommandBuffer> commandBuffers;
+  };
+
+  std::vector<Slice> slices;
+  std::vector<std::thread> threads; // slice i + 1 runs on threads[i]
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  const std::function<void(size_t)> *job = nullptr;
+  size_t jobSlices = 0;
+  size_t remaining = 0;    // threads still running the current job
+  uint64_t generation = 0; // bumped for every job
+  bool stopping = false;
+  std::exception_ptr error;
+
+  void threadLoop(size_t slice);
+};
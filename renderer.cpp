@@ -3,9 +3,10 @@
 #include "renderer.hpp"
 #include "utils.h"
 #include <cstring>
+#include <algorithm>
 
 Renderer::Renderer(Camera &camera, uint32_t &WIDTH, uint32_t &HEIGHT)
-    : bufferManager(), swapchainManager(), deviceManager(swapchainManager), descriptorManager(bufferManager), pipelineManager(swapchainManager, descriptorManager), camera(camera), WIDTH(WIDTH), HEIGHT(HEIGHT)
+    : bufferManager(), swapchainManager(), deviceManager(swapchainManager), descriptorManager(bufferManager), pipelineManager(swapchainManager, descriptorManager), meshRegistry(*this), textureUploader(bufferManager), textureRegistry(*this), camera(camera), WIDTH(WIDTH), HEIGHT(HEIGHT)
 {
 }
 
@@ -14,20 +15,32 @@ void Renderer::initVulkan()
   createInstance();
   swapchainManager.createSurface(instance);
   deviceManager.pickPhysicalDevice(instance, deviceExtensions);
-  deviceManager.createLogicalDevice(enableValidationLayers, deviceExtensions, validationLayers, &presentQueue, &graphicsQueue);
+  deviceManager.createLogicalDevice(enableValidationLayers, deviceExtensions, validationLayers, &presentQueue, &graphicsQueue, &transferQueue);
+  bufferManager.allocator.init(deviceManager.device, deviceManager.physicalDevice);
   swapchainManager.createSwapChain(deviceManager.device, deviceManager.physicalDevice);
   swapchainManager.createImageViews(deviceManager.device);
   pipelineManager.createRenderPass(deviceManager.device, deviceManager.physicalDevice);
-  descriptorManager.createDescriptorSetLayout(deviceManager.device);
+  descriptorManager.createDescriptorSetLayouts(deviceManager.device);
   pipelineManager.createGraphicsPipeline(deviceManager.device);
   createCommandPool();
-  swapchainManager.createDepthResources(deviceManager.device, deviceManager.physicalDevice, commandPool, graphicsQueue);
+  recordWorkers.init(deviceManager.device, deviceManager.queueFamilies.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, std::max(std::thread::hardware_concurrency(), 1u));
+  sliceDraws.resize(recordWorkers.threadCount());
+  secondaryCommandBuffers.resize(recordWorkers.threadCount());
+  sliceDrawCalls.resize(recordWorkers.threadCount());
+  bufferManager.stagingRing.init(deviceManager.device, bufferManager.allocator);
+  bufferManager.uploadContext.init(deviceManager.device, commandPool, graphicsQueue, bufferManager.stagingRing);
+  textureUploader.init(deviceManager.device, deviceManager.physicalDevice, deviceManager.queueFamilies, transferQueue, deviceManager.timelineSemaphores, deviceManager.textureCompressionBC);
+  textureRegistry.init(deviceManager.device, deviceManager.physicalDevice);
+  swapchainManager.createDepthResources(deviceManager.device, deviceManager.physicalDevice, bufferManager.allocator, commandPool, graphicsQueue);
   swapchainManager.createFramebuffers(deviceManager.device, pipelineManager.renderPass);
 
   // bufferManager.createVertexBuffer(vertices, 0, deviceManager.device, deviceManager.physicalDevice, commandPool, graphicsQueue);
   // bufferManager.createIndexBuffer(indices, 0, deviceManager.device, deviceManager.physicalDevice, commandPool, //graphicsQueue);
   // bufferManager.createUniformBuffers(MAX_FRAMES_IN_FLIGHT, deviceManager.device, deviceManager.physicalDevice, 2);
-  descriptorManager.createDescriptorPool(deviceManager.device, MAX_FRAMES_IN_FLIGHT, 20); // 9 for all besides networked players
+  descriptorManager.createDescriptorPools(deviceManager.device, MAX_FRAMES_IN_FLIGHT);
+  bufferManager.createUniformBuffers(MAX_FRAMES_IN_FLIGHT, deviceManager.device, deviceManager.physicalDevice);
+  descriptorManager.createCameraDescriptorSets(deviceManager.device, MAX_FRAMES_IN_FLIGHT);
+  descriptorManager.createTextureDescriptorSet(deviceManager.device);
 
   // descriptorManager.createDescriptorSets(deviceManager.device, MAX_FRAMES_IN_FLIGHT, 1);
   // descriptorManager.addDescriptorSets(deviceManager.device, MAX_FRAMES_IN_FLIGHT, 1);
@@ -50,9 +63,11 @@ void Renderer::recreateSwapChain()
 
   swapchainManager.cleanupSwapChain(deviceManager.device);
 
+  swapchainManager.cleanupDepthImages(deviceManager.device, bufferManager.allocator);
+
   swapchainManager.createSwapChain(deviceManager.device, deviceManager.physicalDevice);
   swapchainManager.createImageViews(deviceManager.device);
-  swapchainManager.createDepthResources(deviceManager.device, deviceManager.physicalDevice, commandPool, graphicsQueue);
+  swapchainManager.createDepthResources(deviceManager.device, deviceManager.physicalDevice, bufferManager.allocator, commandPool, graphicsQueue);
   swapchainManager.createFramebuffers(deviceManager.device, pipelineManager.renderPass);
 }
 
@@ -77,11 +92,6 @@ void Renderer::createSyncObjects()
       throw std::runtime_error("failed to create synchronization objects!");
     }
   }
-
-  if (vkCreateSemaphore(deviceManager.device, &semaphoreInfo, nullptr, &textureUpdateSemaphore) != VK_SUCCESS)
-  {
-    throw std::runtime_error("failed to create texture synchronization object!");
-  }
 }
 
 void Renderer::createCommandBuffer()
@@ -101,6 +111,7 @@ void Renderer::createCommandBuffer()
 
 void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 {
+  auto recordStart = std::chrono::high_resolution_clock::now();
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   beginInfo.flags = 0;
@@ -140,9 +151,6 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager.graphicsPipeline);
-
   VkViewport viewport{};
 
   viewport.x = 0.0f;
@@ -154,16 +162,137 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
 
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
   VkRect2D scissor{};
   scissor.offset = {0, 0};
   scissor.extent = swapchainManager.swapChainExtent;
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
+  glm::mat4 view = camera.GetViewMatrix();
+  glm::mat4 proj = glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 1000.0f);
+  bufferManager.updateUniformBuffer(currentFrame, view, proj);
+  // bound once per secondary buffer, draws pick their texture through the instance data
+  VkDescriptorSet frameDescriptorSets[] = {descriptorManager.cameraDescriptorSets[currentFrame], descriptorManager.textureDescriptorSet};
+
+  // the draws are recorded into secondary buffers, the primary only executes them in order
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+  auto cullStart = std::chrono::high_resolution_clock::now();
+  Frustum frustum;
+  frustum.extract(proj * view);
+  drawList.clear();
   for (auto &drawObject : drawObjects)
   {
-    drawObject.second->draw(this, currentFrame, camera.GetViewMatrix(), glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 1000.0f), commandBuffer);
+    drawList.push_back(drawObject.second);
+  }
+
+  // transforms and visibility only depend on the object, each slice culls its own range
+  size_t cullSlices = recordWorkers.sliceCount(drawList.size(), MIN_DRAWS_PER_SLICE, recordThreads);
+  recordWorkers.run(cullSlices, [&](size_t slice)
+                    {
+    std::vector<VisibleDraw> &draws = sliceDraws[slice];
+    draws.clear();
+    size_t end = RecordWorkers::sliceBegin(drawList.size(), cullSlices, slice + 1);
+    for (size_t i = RecordWorkers::sliceBegin(drawList.size(), cullSlices, slice); i < end; i++)
+    {
+      glm::mat4 model = drawList[i]->getModelMatrix();
+      if (isVisible(frustum, drawList[i]->localBounds, model))
+      {
+        draws.push_back({drawList[i], model});
+      }
+    } });
+
+  // objects with the same mesh end up next to each other and become one instanced draw, whatever their
+  // textures. Mesh handles are small, so a counting sort does it in two passes.
+  meshOffsets.clear();
+  for (size_t slice = 0; slice < cullSlices; slice++)
+  {
+    for (const VisibleDraw &draw : sliceDraws[slice])
+    {
+      size_t mesh = static_cast<size_t>(draw.object->mesh);
+      if (mesh >= meshOffsets.size())
+      {
+        meshOffsets.resize(mesh + 1, 0);
+      }
+      meshOffsets[mesh]++;
+    }
+  }
+  size_t visibleCount = 0;
+  for (size_t &offset : meshOffsets)
+  {
+    size_t count = offset;
+    offset = visibleCount;
+    visibleCount += count;
+  }
+  visibleDraws.resize(visibleCount);
+  for (size_t slice = 0; slice < cullSlices; slice++)
+  {
+    for (const VisibleDraw &draw : sliceDraws[slice])
+    {
+      visibleDraws[meshOffsets[static_cast<size_t>(draw.object->mesh)]++] = draw;
+    }
+  }
+
+  cullingStats.total = static_cast<int>(drawObjects.size());
+  cullingStats.visible = static_cast<int>(visibleDraws.size());
+  cullingStats.cullMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+  cullingStats.drawCalls = 0;
+  cullingStats.recordSlices = 0;
+
+  if (!visibleDraws.empty())
+  {
+    bufferManager.reserveInstanceBuffer(currentFrame, visibleDraws.size(), deviceManager.device, deviceManager.physicalDevice);
+    InstanceData *instances = static_cast<InstanceData *>(bufferManager.instanceBuffersMapped[currentFrame]);
+    VkBuffer instanceBuffer = bufferManager.instanceBuffers[currentFrame];
+    VkDeviceSize instanceOffset = 0;
+    VkFramebuffer framebuffer = swapchainManager.swapChainFramebuffers[imageIndex];
+
+    // every slice writes its range of the instance buffer and records it with its own pool, nothing is shared
+    size_t recordSlices = recordWorkers.sliceCount(visibleDraws.size(), MIN_DRAWS_PER_SLICE, recordThreads);
+    auto sameBatch = [](const GameObject *a, const GameObject *b)
+    { return a->mesh == b->mesh; };
+    recordWorkers.run(recordSlices, [&](size_t slice)
+                      {
+      size_t begin = RecordWorkers::sliceBegin(visibleDraws.size(), recordSlices, slice);
+      size_t end = RecordWorkers::sliceBegin(visibleDraws.size(), recordSlices, slice + 1);
+      for (size_t i = begin; i < end; i++)
+      {
+        instances[i].model = visibleDraws[i].model;
+        instances[i].textureIndex = static_cast<uint32_t>(visibleDraws[i].object->texture);
+      }
+
+      // nothing is inherited from the primary, each secondary sets up the whole state
+      VkCommandBuffer secondary = recordWorkers.beginSecondary(deviceManager.device, slice, currentFrame, pipelineManager.renderPass, framebuffer);
+      vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager.graphicsPipeline);
+      vkCmdSetViewport(secondary, 0, 1, &viewport);
+      vkCmdSetScissor(secondary, 0, 1, &scissor);
+      vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager.pipelineLayout, 0, 2, frameDescriptorSets, 0, nullptr);
+      vkCmdBindVertexBuffers(secondary, 1, 1, &instanceBuffer, &instanceOffset);
+
+      // the first object of a batch draws for all of them, a batch cut by the slice edge is drawn on both sides
+      int drawCalls = 0;
+      size_t batchStart = begin;
+      for (size_t i = begin + 1; i <= end; i++)
+      {
+        if (i == end || !sameBatch(visibleDraws[batchStart].object, visibleDraws[i].object))
+        {
+          visibleDraws[batchStart].object->draw(this, secondary, static_cast<uint32_t>(i - batchStart), static_cast<uint32_t>(batchStart));
+          drawCalls++;
+          batchStart = i;
+        }
+      }
+
+      if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to record secondary command buffer!");
+      }
+      secondaryCommandBuffers[slice] = secondary;
+      sliceDrawCalls[slice] = drawCalls; });
+
+    vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(recordSlices), secondaryCommandBuffers.data());
+    for (size_t slice = 0; slice < recordSlices; slice++)
+    {
+      cullingStats.drawCalls += sliceDrawCalls[slice];
+    }
+    cullingStats.recordSlices = static_cast<int>(recordSlices);
   }
 
   /*
@@ -187,6 +316,7 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
   {
     throw std::runtime_error("failed to record command buffer!");
   }
+  cullingStats.recordMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
 }
 
 void Renderer::createCommandPool()
@@ -207,6 +337,7 @@ void Renderer::createCommandPool()
 void Renderer::drawFrame()
 {
   vkWaitForFences(deviceManager.device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+  destroyRetiredResources(false);
 
   uint32_t imageIndex;
   VkResult result = vkAcquireNextImageKHR(deviceManager.device, swapchainManager.swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
@@ -227,21 +358,24 @@ void Renderer::drawFrame()
 
   recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
 
+  // uploads recorded since the last frame reach the queue ahead of the draws that use them
+  bufferManager.uploadContext.flush(deviceManager.device);
+
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame], textureUpdateSemaphore};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT};
+  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
+  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 
-  submitInfo.waitSemaphoreCount = 2;
+  submitInfo.waitSemaphoreCount = 1;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
 
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame], textureUpdateSemaphore};
-  submitInfo.signalSemaphoreCount = 2;
+  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
+  submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
   if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
@@ -252,7 +386,7 @@ void Renderer::drawFrame()
   VkPresentInfoKHR presentInfo{};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-  presentInfo.waitSemaphoreCount = 2;
+  presentInfo.waitSemaphoreCount = 1;
   presentInfo.pWaitSemaphores = signalSemaphores;
 
   VkSwapchainKHR swapChains[] = {swapchainManager.swapChain};
@@ -274,10 +408,50 @@ void Renderer::drawFrame()
   }
 
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  frameNumber++;
+}
+
+void Renderer::destroyAfterFrames(std::function<void()> destroy)
+{
+  // every frame submitted so far is done once the fence MAX_FRAMES_IN_FLIGHT frames later was waited on
+  retiredResources.push_back({frameNumber + MAX_FRAMES_IN_FLIGHT, std::move(destroy)});
+}
+
+void Renderer::destroyRetiredResources(bool all)
+{
+  while (!retiredResources.empty() && (all || retiredResources.front().safeFrame <= frameNumber))
+  {
+    retiredResources.front().destroy();
+    retiredResources.pop_front();
+  }
 }
 
 void Renderer::cleanup()
 {
+  vkDeviceWaitIdle(deviceManager.device);
+  recordWorkers.cleanup(deviceManager.device);
+  textureUploader.cleanup(deviceManager.device);
+  destroyRetiredResources(true);
+
+  swapchainManager.cleanupDepthImages(deviceManager.device, bufferManager.allocator);
+  swapchainManager.cleanupSwapChain(deviceManager.device);
+
+  textureRegistry.cleanup(deviceManager.device);
+  meshRegistry.cleanup(deviceManager.device);
+  bufferManager.cleanup(deviceManager.device);
+  descriptorManager.cleanup(deviceManager.device);
+  pipelineManager.cleanup(deviceManager.device);
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+  {
+    vkDestroySemaphore(deviceManager.device, renderFinishedSemaphores[i], nullptr);
+    vkDestroySemaphore(deviceManager.device, imageAvailableSemaphores[i], nullptr);
+    vkDestroyFence(deviceManager.device, inFlightFences[i], nullptr);
+  }
+
+  // the upload context's buffers come from this pool, so it goes after bufferManager
+  vkDestroyCommandPool(deviceManager.device, commandPool, nullptr);
+  bufferManager.allocator.cleanup(deviceManager.device);
 
   vkDestroyDevice(deviceManager.device, nullptr);
   vkDestroySurfaceKHR(instance, swapchainManager.surface, nullptr);
@@ -301,7 +475,7 @@ void Renderer::createInstance()
   appInfo.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
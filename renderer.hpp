@@ -10,13 +10,19 @@
 #include <memory>
 #include "swapchainManager.hpp"
 #include "deviceManager.hpp"
-#include "textureManager.hpp"
+#include "textureRegistry.hpp"
 #include "descriptorManager.hpp"
 #include "pipelineManager.hpp"
 #include "camera.h"
 #include "gameObject.hpp"
 #include "bufferManager.hpp"
 #include "vertex.h"
+#include "meshRegistry.hpp"
+#include "frustumCulling.hpp"
+#include "asyncTextureUploader.hpp"
+#include "recordWorkers.hpp"
+#include <deque>
+#include <functional>
 
 class Camera;
 class SwapchainManager;
@@ -49,28 +55,37 @@ public:
   VkInstance instance;
   VkQueue graphicsQueue;
   VkQueue presentQueue;
+  VkQueue transferQueue; // VK_NULL_HANDLE without a transfer-only queue family
 
   SwapchainManager swapchainManager;
   BufferManager bufferManager;
   DescriptorManager descriptorManager;
   PipelineManager pipelineManager;
   DeviceManager deviceManager;
+  MeshRegistry meshRegistry;
+  AsyncTextureUploader textureUploader;
+  TextureRegistry textureRegistry;
 
   std::unordered_map<int, GameObject *> drawObjects;
+  CullingStats cullingStats; // from the last recorded frame
+  RecordWorkers recordWorkers;
+  size_t recordThreads = 0; // most slices a frame is culled and recorded in, 0 for one per core
 
   VkCommandPool commandPool;
   std::vector<VkCommandBuffer> commandBuffers;
 
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
-  VkSemaphore textureUpdateSemaphore;
   std::vector<VkFence> inFlightFences;
 
   bool framebufferResized = true;
 
   void drawFrame();
+  // Runs destroy once no frame that was already submitted can still use what it frees
+  void destroyAfterFrames(std::function<void()> destroy);
+  void destroyRetiredResources(bool all); // all only once the device is idle
 
-  void cleanup();
+  void cleanup(); // tears down everything initVulkan created, every mode calls it exactly once
 
 private:
   uint32_t &WIDTH;
@@ -78,6 +93,24 @@ private:
   std::vector<Vertex> vertices;
   std::vector<uint32_t> indices;
   uint32_t currentFrame = 0;
+  uint64_t frameNumber = 0;
+  struct RetiredResource
+  {
+    uint64_t safeFrame;
+    std::function<void()> destroy;
+  };
+  std::deque<RetiredResource> retiredResources;
+  struct VisibleDraw
+  {
+    GameObject *object;
+    glm::mat4 model;
+  };
+  std::vector<VisibleDraw> visibleDraws;
+  std::vector<GameObject *> drawList;
+  std::vector<std::vector<VisibleDraw>> sliceDraws; // what each slice found visible, merged into visibleDraws
+  std::vector<size_t> meshOffsets;
+  std::vector<VkCommandBuffer> secondaryCommandBuffers; // executed in slice order
+  std::vector<int> sliceDrawCalls;
 
   void createInstance();
   bool checkValidationLayerSupport();
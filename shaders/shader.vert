@@ -1,22 +1,25 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(set = 0, binding = 0) uniform CameraUniformBufferObject {
     mat4 view;
     mat4 proj;
-} ubo;
+} camera;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in mat4 inModel; // per instance, locations 3 to 6
+layout(location = 7) in uint inTextureIndex; // per instance
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = camera.proj * camera.view * inModel * vec4(inPosition, 1.0);
     float gradient = clamp(inPosition.y / 200.0, 0.0, 1.0);
     fragColor = mix(vec3(0.1, 0.1, 0.1), vec3(1.0, 1.0, 1.0), gradient);
     ;
     fragTexCoord = inTexCoord;
+    fragTextureIndex = inTextureIndex;
 }
\ No newline at end of file
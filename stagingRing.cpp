@@ -0,0 +1,195 @@
+#include "stagingRing.hpp"
+#include "utils.h"
+#include <stdexcept>
+
+void StagingRing::init(VkDevice device, GpuAllocator &allocator, VkDeviceSize size)
+{
+  this->allocator = &allocator;
+  createBuffer(device, size);
+}
+
+void StagingRing::cleanup(VkDevice device)
+{
+  while (!inFlight.empty())
+  {
+    retire(device, true);
+  }
+  for (VkFence fence : freeFences)
+  {
+    vkDestroyFence(device, fence, nullptr);
+  }
+  freeFences.clear();
+  destroyBuffer(device);
+}
+
+StagingAllocation StagingRing::allocate(VkDevice device, VkDeviceSize allocationSize, VkDeviceSize alignment)
+{
+  if (allocationSize + alignment > size)
+  {
+    if (hasUnclaimed)
+    {
+      throw std::runtime_error("staging ring cannot grow while allocations are waiting to be submitted!");
+    }
+
+    // drain and replace the buffer, nothing references it anymore once every fence has signalled
+    while (!inFlight.empty())
+    {
+      retire(device, true);
+    }
+    VkDeviceSize newSize = size;
+    while (newSize < allocationSize + alignment)
+    {
+      newSize *= 2;
+    }
+    destroyBuffer(device);
+    createBuffer(device, newSize);
+  }
+
+  VkDeviceSize offset = 0;
+  retire(device, false);
+  while (!tryAllocate(allocationSize, alignment, offset))
+  {
+    if (inFlight.empty())
+    {
+      throw std::runtime_error("staging ring is full of allocations that were never submitted!");
+    }
+    retire(device, true);
+  }
+
+  hasUnclaimed = true;
+  unclaimed += allocationSize + alignment;
+  return {buffer, offset, mapped + offset};
+}
+
+VkFence StagingRing::claimFence(VkDevice device)
+{
+  VkFence fence;
+  if (!freeFences.empty())
+  {
+    fence = freeFences.back();
+    freeFences.pop_back();
+  }
+  else
+  {
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create staging ring fence!");
+    }
+  }
+
+  inFlight.push_back({head, fence});
+  hasUnclaimed = false;
+  unclaimed = 0;
+  claimed++;
+  return fence;
+}
+
+bool StagingRing::isRetired(VkDevice device, uint64_t claim)
+{
+  retire(device, false);
+  return claim <= retired;
+}
+
+void StagingRing::waitRetired(VkDevice device, uint64_t claim)
+{
+  retire(device, false);
+  while (retired < claim && !inFlight.empty())
+  {
+    retire(device, true);
+  }
+}
+
+bool StagingRing::tryAllocate(VkDeviceSize allocationSize, VkDeviceSize alignment, VkDeviceSize &offset)
+{
+  if (inFlight.empty() && !hasUnclaimed)
+  {
+    head = 0;
+    tail = 0;
+  }
+
+  VkDeviceSize aligned = (head + alignment - 1) / alignment * alignment;
+  if (head >= tail)
+  {
+    // free space is [head, size) and, after wrapping, [0, tail)
+    if (aligned + allocationSize <= size)
+    {
+      offset = aligned;
+      head = aligned + allocationSize;
+      return true;
+    }
+    if (allocationSize < tail)
+    {
+      offset = 0;
+      head = allocationSize;
+      return true;
+    }
+    return false;
+  }
+
+  // wrapped, free space is [head, tail), kept strictly below tail so head == tail only means empty
+  if (aligned + allocationSize < tail)
+  {
+    offset = aligned;
+    head = aligned + allocationSize;
+    return true;
+  }
+  return false;
+}
+
+void StagingRing::retire(VkDevice device, bool waitForOldest)
+{
+  if (waitForOldest && !inFlight.empty())
+  {
+    vkWaitForFences(device, 1, &inFlight.front().fence, VK_TRUE, UINT64_MAX);
+  }
+
+  while (!inFlight.empty() && vkGetFenceStatus(device, inFlight.front().fence) == VK_SUCCESS)
+  {
+    tail = inFlight.front().end;
+    vkResetFences(device, 1, &inFlight.front().fence);
+    freeFences.push_back(inFlight.front().fence);
+    inFlight.pop_front();
+    retired++;
+  }
+}
+
+void StagingRing::createBuffer(VkDevice device, VkDeviceSize bufferSize)
+{
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = bufferSize;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create staging ring buffer!");
+  }
+
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+  allocation = allocator->allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+
+  vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+  mapped = static_cast<unsigned char *>(allocation.mapped);
+
+  size = bufferSize;
+  head = 0;
+  tail = 0;
+}
+
+void StagingRing::destroyBuffer(VkDevice device)
+{
+  if (buffer == VK_NULL_HANDLE)
+  {
+    return;
+  }
+
+  vkDestroyBuffer(device, buffer, nullptr);
+  allocator->free(allocation);
+  buffer = VK_NULL_HANDLE;
+  mapped = nullptr;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <vector>
+#include "gpuAllocator.hpp"
+
+#define STAGING_RING_SIZE (16 * 1024 * 1024) // grows to fit a larger single upload
+
+struct StagingAllocation
+{
+  VkBuffer buffer;
+  VkDeviceSize offset;
+  void *data; // persistently mapped, coherent
+};
+
+// One host-visible upload buffer shared by vertex, index and texture uploads. Space is handed out
+// front to back and is recycled once the fence of the submission that read it has signalled.
+class StagingRing
+{
+public:
+  void init(VkDevice device, GpuAllocator &allocator, VkDeviceSize size = STAGING_RING_SIZE);
+  void cleanup(VkDevice device);
+
+  // May wait for older uploads to finish when the ring is full
+  StagingAllocation allocate(VkDevice device, VkDeviceSize size, VkDeviceSize alignment = 16);
+  // Covers every allocation since the last call, submit the copies that read them with this fence
+  VkFence claimFence(VkDevice device);
+
+  // Fences are claimed and signal in order, so the n-th claim is done once n fences have retired
+  uint64_t claimedCount() const { return claimed; }
+  bool isRetired(VkDevice device, uint64_t claim);
+  void waitRetired(VkDevice device, uint64_t claim);
+
+  VkDeviceSize capacity() const { return size; }
+  VkDeviceSize unclaimedBytes() const { return unclaimed; }
+
+private:
+  struct Region
+  {
+    VkDeviceSize end;
+    VkFence fence;
+  };
+
+  GpuAllocator *allocator = nullptr;
+  VkBuffer buffer = VK_NULL_HANDLE;
+  GpuAllocation allocation;
+  unsigned char *mapped = nullptr;
+  VkDeviceSize size = 0;
+  VkDeviceSize head = 0; // next free byte
+  VkDeviceSize tail = 0; // first byte still read by an in-flight submission
+  bool hasUnclaimed = false;
+  VkDeviceSize unclaimed = 0;
+  uint64_t claimed = 0;
+  uint64_t retired = 0;
+  std::deque<Region> inFlight;
+  std::vector<VkFence> freeFences;
+
+  bool tryAllocate(VkDeviceSize allocationSize, VkDeviceSize alignment, VkDeviceSize &offset);
+  void retire(VkDevice device, bool waitForOldest);
+  void createBuffer(VkDevice device, VkDeviceSize bufferSize);
+  void destroyBuffer(VkDevice device);
+};
@@ -178,11 +178,11 @@ void SwapchainManager::cleanupSwapChain(VkDevice device)
   vkDestroySwapchainKHR(device, swapChain, nullptr);
 }
 
-void SwapchainManager::cleanupDepthImages(VkDevice device)
+void SwapchainManager::cleanupDepthImages(VkDevice device, GpuAllocator &allocator)
 {
   vkDestroyImageView(device, depthImageView, nullptr);
   vkDestroyImage(device, depthImage, nullptr);
-  vkFreeMemory(device, depthImageMemory, nullptr);
+  allocator.free(depthImageAllocation);
 }
 
 void SwapchainManager::createImageViews(VkDevice device)
@@ -221,10 +221,10 @@ void SwapchainManager::createFramebuffers(VkDevice device, VkRenderPass renderPa
   }
 }
 
-void SwapchainManager::createDepthResources(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue)
+void SwapchainManager::createDepthResources(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator &allocator, VkCommandPool commandPool, VkQueue graphicsQueue)
 {
   VkFormat depthFormat = findDepthFormat(physicalDevice);
-  createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory, device, physicalDevice);
+  createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageAllocation, allocator, device);
   depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, device);
 
   transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, device, commandPool, graphicsQueue);
@@ -4,6 +4,7 @@
 #include <memory>
 #include <stdexcept>
 #include <GLFW/glfw3.h>
+#include "gpuAllocator.hpp"
 
 struct SwapChainSupportDetails;
 class SwapchainManager
@@ -18,7 +19,7 @@ public:
   std::vector<VkImageView> swapChainImageViews;
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkImage depthImage;
-  VkDeviceMemory depthImageMemory;
+  GpuAllocation depthImageAllocation;
   VkImageView depthImageView;
 
   SwapchainManager(GLFWwindow *window) : window(window)
@@ -46,12 +47,12 @@ public:
   VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
   void cleanupSwapChain(VkDevice device);
-  void cleanupDepthImages(VkDevice device);
+  void cleanupDepthImages(VkDevice device, GpuAllocator &allocator);
 
   void createImageViews(VkDevice device);
 
   void createFramebuffers(VkDevice device, VkRenderPass renderPass);
 
-  void createDepthResources(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
+  void createDepthResources(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator &allocator, VkCommandPool commandPool, VkQueue graphicsQueue);
   VkFormat findDepthFormat(VkPhysicalDevice physicalDevice);
 };
\ No newline at end of file
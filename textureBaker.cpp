@@ -0,0 +1,319 @@
+#include "textureBaker.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+  float srgbToLinear(float value)
+  {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+  }
+
+  unsigned char linearToSrgb(float value)
+  {
+    value = std::clamp(value, 0.0f, 1.0f);
+    float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<unsigned char>(std::lround(srgb * 255.0f));
+  }
+
+  uint16_t packRgb565(const float color[3])
+  {
+    int r = static_cast<int>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+    int g = static_cast<int>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+    int b = static_cast<int>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+  }
+
+  void unpackRgb565(uint16_t packed, float color[3])
+  {
+    color[0] = ((packed >> 11) & 31) * 255.0f / 31.0f;
+    color[1] = ((packed >> 5) & 63) * 255.0f / 63.0f;
+    color[2] = (packed & 31) * 255.0f / 31.0f;
+  }
+
+  // halves a level with a 2x2 box in linear light, the odd last row or column is clamped
+  std::vector<unsigned char> downsample(const std::vector<unsigned char> &source, uint32_t width, uint32_t height, const float linear[256])
+  {
+    uint32_t nextWidth = std::max(width / 2, 1u);
+    uint32_t nextHeight = std::max(height / 2, 1u);
+    std::vector<unsigned char> result(static_cast<size_t>(nextWidth) * nextHeight * 4);
+
+    for (uint32_t y = 0; y < nextHeight; y++)
+    {
+      for (uint32_t x = 0; x < nextWidth; x++)
+      {
+        uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+        uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        const unsigned char *texels[4] = {&source[(y0 * width + x0) * 4], &source[(y0 * width + x1) * 4], &source[(y1 * width + x0) * 4], &source[(y1 * width + x1) * 4]};
+
+        unsigned char *out = &result[(static_cast<size_t>(y) * nextWidth + x) * 4];
+        for (int channel = 0; channel < 3; channel++)
+        {
+          float sum = 0.0f;
+          for (const unsigned char *texel : texels)
+          {
+            sum += linear[texel[channel]];
+          }
+          out[channel] = linearToSrgb(sum * 0.25f);
+        }
+        out[3] = static_cast<unsigned char>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+      }
+    }
+    return result;
+  }
+}
+
+void encodeBC1Block(const unsigned char rgba[64], unsigned char out[8])
+{
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < 16; i++)
+  {
+    for (int c = 0; c < 3; c++)
+    {
+      mean[c] += rgba[i * 4 + c] / 16.0f;
+    }
+  }
+
+  float covariance[6] = {}; // rr rg rb gg gb bb
+  for (int i = 0; i < 16; i++)
+  {
+    float r = rgba[i * 4] - mean[0], g = rgba[i * 4 + 1] - mean[1], b = rgba[i * 4 + 2] - mean[2];
+    covariance[0] += r * r;
+    covariance[1] += r * g;
+    covariance[2] += r * b;
+    covariance[3] += g * g;
+    covariance[4] += g * b;
+    covariance[5] += b * b;
+  }
+
+  // principal axis by power iteration, the endpoints are the extreme projections on it
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; iteration++)
+  {
+    float next[3] = {covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                     covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                     covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+    float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+    if (length < 1e-6f)
+    {
+      break;
+    }
+    for (int c = 0; c < 3; c++)
+    {
+      axis[c] = next[c] / length;
+    }
+  }
+
+  float minProjection = 0.0f, maxProjection = 0.0f;
+  for (int i = 0; i < 16; i++)
+  {
+    float projection = (rgba[i * 4] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] + (rgba[i * 4 + 2] - mean[2]) * axis[2];
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+
+  float high[3], low[3];
+  for (int c = 0; c < 3; c++)
+  {
+    high[c] = mean[c] + axis[c] * maxProjection;
+    low[c] = mean[c] + axis[c] * minProjection;
+  }
+
+  // color0 > color1 selects the four colour mode
+  uint16_t color0 = packRgb565(high);
+  uint16_t color1 = packRgb565(low);
+  if (color0 < color1)
+  {
+    std::swap(color0, color1);
+  }
+
+  uint32_t indices = 0;
+  if (color0 != color1)
+  {
+    float palette[4][3];
+    unpackRgb565(color0, palette[0]);
+    unpackRgb565(color1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+      palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+      palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+      uint32_t best = 0;
+      float bestDistance = INFINITY;
+      for (uint32_t entry = 0; entry < 4; entry++)
+      {
+        float distance = 0.0f;
+        for (int c = 0; c < 3; c++)
+        {
+          float difference = rgba[i * 4 + c] - palette[entry][c];
+          distance += difference * difference;
+        }
+        if (distance < bestDistance)
+        {
+          bestDistance = distance;
+          best = entry;
+        }
+      }
+      indices |= best << (i * 2);
+    }
+  }
+
+  out[0] = static_cast<unsigned char>(color0 & 0xFF);
+  out[1] = static_cast<unsigned char>(color0 >> 8);
+  out[2] = static_cast<unsigned char>(color1 & 0xFF);
+  out[3] = static_cast<unsigned char>(color1 >> 8);
+  for (int i = 0; i < 4; i++)
+  {
+    out[4 + i] = static_cast<unsigned char>(indices >> (i * 8));
+  }
+}
+
+TextureData compressTexture(const TextureData &rgba)
+{
+  float linear[256];
+  for (int i = 0; i < 256; i++)
+  {
+    linear[i] = srgbToLinear(i / 255.0f);
+  }
+
+  TextureData compressed;
+  compressed.format = COMPRESSED_TEXTURE_FORMAT;
+  compressed.width = rgba.width;
+  compressed.height = rgba.height;
+
+  std::vector<unsigned char> level(rgba.bytes.begin(), rgba.bytes.begin() + rgba.levels[0].size);
+  uint32_t width = rgba.width;
+  uint32_t height = rgba.height;
+
+  // down to 1x1, the same chain generateMipmaps builds for a PNG
+  while (true)
+  {
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    TextureLevel compressedLevel{static_cast<VkDeviceSize>(compressed.bytes.size()), static_cast<VkDeviceSize>(blocksWide) * blocksHigh * 8, width, height};
+    compressed.bytes.resize(compressed.bytes.size() + compressedLevel.size);
+
+    unsigned char *out = compressed.bytes.data() + compressedLevel.offset;
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+    {
+      for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+      {
+        // texels past the edge repeat the last row or column so they don't pull the endpoints
+        unsigned char block[64];
+        for (uint32_t y = 0; y < 4; y++)
+        {
+          for (uint32_t x = 0; x < 4; x++)
+          {
+            uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+            uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+            std::copy_n(&level[(static_cast<size_t>(sourceY) * width + sourceX) * 4], 4, &block[(y * 4 + x) * 4]);
+          }
+        }
+        encodeBC1Block(block, out);
+        out += 8;
+      }
+    }
+    compressed.levels.push_back(compressedLevel);
+
+    if (width == 1 && height == 1)
+    {
+      break;
+    }
+    level = downsample(level, width, height, linear);
+    width = std::max(width / 2, 1u);
+    height = std::max(height / 2, 1u);
+  }
+  return compressed;
+}
+
+void runTextureBake(const std::vector<std::string> &directories)
+{
+  size_t baked = 0;
+  size_t skipped = 0;
+  VkDeviceSize uncompressedBytes = 0;
+  VkDeviceSize compressedBytes = 0;
+  double pngLoadMs = 0.0;
+  double ktxLoadMs = 0.0;
+
+  for (const std::string &directory : directories)
+  {
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+      if (!it->is_regular_file() || it->path().extension() != ".png")
+      {
+        continue;
+      }
+
+      std::string path = it->path().generic_string();
+      TextureData rgba;
+      auto pngStart = std::chrono::high_resolution_clock::now();
+      if (!loadTextureData(path, false, rgba))
+      {
+        std::cerr << "Failed to decode " << path << std::endl;
+        skipped++;
+        continue;
+      }
+      double pngMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pngStart).count();
+
+      bool opaque = true;
+      for (size_t i = 3; i < rgba.bytes.size() && opaque; i += 4)
+      {
+        opaque = rgba.bytes[i] == 255;
+      }
+      if (!opaque)
+      {
+        std::cout << path << ": has transparency, left as PNG" << std::endl;
+        skipped++;
+        continue;
+      }
+
+      TextureData compressed = compressTexture(rgba);
+      std::string ktxPath = compressedTexturePath(path);
+      if (!writeKtx2(ktxPath, compressed))
+      {
+        std::cerr << "Failed to write " << ktxPath << std::endl;
+        skipped++;
+        continue;
+      }
+
+      TextureData reloaded;
+      auto ktxStart = std::chrono::high_resolution_clock::now();
+      if (!readKtx2(ktxPath, reloaded))
+      {
+        std::cerr << "Failed to read back " << ktxPath << std::endl;
+        skipped++;
+        continue;
+      }
+      double ktxMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - ktxStart).count();
+
+      // the PNG path in VRAM is RGBA8 with a blitted chain of the same length
+      VkDeviceSize rgbaChainBytes = 0;
+      for (const TextureLevel &level : compressed.levels)
+      {
+        rgbaChainBytes += static_cast<VkDeviceSize>(level.width) * level.height * 4;
+      }
+
+      std::cout << path << ": " << rgba.width << "x" << rgba.height << ", " << compressed.levels.size() << " levels, "
+                << rgbaChainBytes / 1024.0 << " -> " << compressed.bytes.size() / 1024.0 << " KiB, load " << pngMs << " -> " << ktxMs << " ms" << std::endl;
+      baked++;
+      uncompressedBytes += rgbaChainBytes;
+      compressedBytes += compressed.bytes.size();
+      pngLoadMs += pngMs;
+      ktxLoadMs += ktxMs;
+    }
+  }
+
+  std::cout << "Baked " << baked << " textures, skipped " << skipped << std::endl;
+  if (baked > 0)
+  {
+    std::cout << "  VRAM " << uncompressedBytes / 1024.0 << " -> " << compressedBytes / 1024.0 << " KiB (" << static_cast<double>(uncompressedBytes) / compressedBytes
+              << "x), load " << pngLoadMs << " -> " << ktxLoadMs << " ms" << std::endl;
+  }
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "textureFile.hpp"
+
+// Compresses one 4x4 block of RGBA8 texels, row by row, into 8 bytes of BC1. Alpha is ignored.
+void encodeBC1Block(const unsigned char rgba[64], unsigned char out[8]);
+
+// Builds the full mip chain of a decoded RGBA8 texture, filtering in linear light, and compresses
+// every level to COMPRESSED_TEXTURE_FORMAT
+TextureData compressTexture(const TextureData &rgba);
+
+// Writes a .ktx2 next to every PNG under the directories and prints what it saved in VRAM and load
+// time. Images with transparency stay PNG only, BC1 here has no alpha.
+void runTextureBake(const std::vector<std::string> &directories);
@@ -0,0 +1,273 @@
+#include "textureFile.hpp"
+#include "utils.h"
+#include <stb_image.h>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+
+namespace
+{
+  const unsigned char KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+#pragma pack(push, 1)
+  // follows the identifier, sgdByteOffset sits at file offset 64 without padding
+  struct Ktx2Header
+  {
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+  };
+
+  struct Ktx2LevelIndex
+  {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+  };
+#pragma pack(pop)
+
+  VkDeviceSize bc1LevelSize(uint32_t width, uint32_t height)
+  {
+    return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * 8;
+  }
+
+  // Khronos basic data format descriptor for BC1 without alpha in sRGB, one 64-bit sample per block
+  std::vector<uint32_t> bc1DataFormatDescriptor()
+  {
+    std::vector<uint32_t> dfd(1 + 6 + 4);
+    dfd[0] = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t)); // totalSize
+    dfd[1] = 0;                                                    // Khronos vendor, basic descriptor type
+    dfd[2] = 2 | ((24 + 16) << 16);                                // version 2, block size with one sample
+    dfd[3] = 128 | (1 << 8) | (2 << 16);                           // BC1A colour model, BT.709 primaries, sRGB transfer
+    dfd[4] = 3 | (3 << 8);                                         // 4x4x1x1 texel block, stored minus one
+    dfd[5] = 8;                                                    // bytes in plane 0
+    dfd[6] = 0;
+    dfd[7] = 0 | (63 << 16);                                       // sample at bit 0, 64 bits, colour channel
+    dfd[8] = 0;                                                    // sample position
+    dfd[9] = 0;                                                    // lower
+    dfd[10] = 0xFFFFFFFF;                                          // upper
+    return dfd;
+  }
+}
+
+uint32_t TextureData::imageMipLevels(bool generateMipmaps) const
+{
+  if (compressed())
+  {
+    return static_cast<uint32_t>(levels.size());
+  }
+  return generateMipmaps ? fullMipLevels(width, height) : 1;
+}
+
+VkDeviceSize TextureData::imageBytes(uint32_t mipLevels) const
+{
+  if (compressed())
+  {
+    return bytes.size();
+  }
+
+  VkDeviceSize total = 0;
+  for (uint32_t level = 0; level < mipLevels; level++)
+  {
+    total += static_cast<VkDeviceSize>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+  }
+  return total;
+}
+
+std::string compressedTexturePath(const std::string &path)
+{
+  size_t dot = path.find_last_of('.');
+  size_t slash = path.find_last_of("/\\");
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+  {
+    return path + ".ktx2";
+  }
+  return path.substr(0, dot) + ".ktx2";
+}
+
+bool loadTextureData(const std::string &path, bool compressed, TextureData &texture)
+{
+  if (compressed)
+  {
+    // a PNG edited after the last bake wins over the stale .ktx2
+    std::error_code error;
+    std::string ktxPath = compressedTexturePath(path);
+    auto ktxTime = std::filesystem::last_write_time(ktxPath, error);
+    bool fresh = !error;
+    auto pngTime = std::filesystem::last_write_time(path, error);
+    if (fresh && (error || ktxTime >= pngTime) && readKtx2(ktxPath, texture))
+    {
+      return true;
+    }
+  }
+
+  int texWidth, texHeight, texChannels;
+  stbi_uc *pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+  if (!pixels)
+  {
+    return false;
+  }
+
+  VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
+  texture.format = VK_FORMAT_R8G8B8A8_SRGB;
+  texture.width = static_cast<uint32_t>(texWidth);
+  texture.height = static_cast<uint32_t>(texHeight);
+  texture.levels = {{0, imageSize, texture.width, texture.height}};
+  texture.bytes.assign(pixels, pixels + imageSize);
+  stbi_image_free(pixels);
+  return true;
+}
+
+bool readKtx2(const std::string &path, TextureData &texture)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  unsigned char identifier[12];
+  Ktx2Header header;
+  file.read(reinterpret_cast<char *>(identifier), sizeof(identifier));
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || memcmp(identifier, KTX2_IDENTIFIER, sizeof(identifier)) != 0)
+  {
+    return false;
+  }
+
+  // only what the baker writes: 2D, one layer and face, not supercompressed
+  if (header.vkFormat != COMPRESSED_TEXTURE_FORMAT || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0 || header.levelCount == 0)
+  {
+    return false;
+  }
+
+  std::vector<Ktx2LevelIndex> levelIndex(header.levelCount);
+  file.read(reinterpret_cast<char *>(levelIndex.data()), levelIndex.size() * sizeof(Ktx2LevelIndex));
+  if (!file)
+  {
+    return false;
+  }
+
+  texture.format = static_cast<VkFormat>(header.vkFormat);
+  texture.width = header.pixelWidth;
+  texture.height = header.pixelHeight;
+  texture.levels.clear();
+  texture.bytes.clear();
+
+  for (uint32_t level = 0; level < header.levelCount; level++)
+  {
+    uint32_t width = std::max(header.pixelWidth >> level, 1u);
+    uint32_t height = std::max(header.pixelHeight >> level, 1u);
+    if (levelIndex[level].byteLength != bc1LevelSize(width, height))
+    {
+      return false;
+    }
+
+    texture.levels.push_back({static_cast<VkDeviceSize>(texture.bytes.size()), levelIndex[level].byteLength, width, height});
+    texture.bytes.resize(texture.bytes.size() + levelIndex[level].byteLength);
+    file.seekg(static_cast<std::streamoff>(levelIndex[level].byteOffset));
+    file.read(reinterpret_cast<char *>(texture.bytes.data() + texture.levels.back().offset), static_cast<std::streamsize>(levelIndex[level].byteLength));
+    if (!file)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool writeKtx2(const std::string &path, const TextureData &texture)
+{
+  if (texture.format != COMPRESSED_TEXTURE_FORMAT || texture.levels.empty())
+  {
+    return false;
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  std::vector<uint32_t> dfd = bc1DataFormatDescriptor();
+  uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+
+  Ktx2Header header{};
+  header.vkFormat = texture.format;
+  header.typeSize = 1;
+  header.pixelWidth = texture.width;
+  header.pixelHeight = texture.height;
+  header.pixelDepth = 0;
+  header.layerCount = 0;
+  header.faceCount = 1;
+  header.levelCount = levelCount;
+  header.supercompressionScheme = 0;
+  header.dfdByteOffset = static_cast<uint32_t>(sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex));
+  header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+  // level data follows the descriptor, smallest level first, each aligned to the 8 byte block
+  std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+  uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+  for (uint32_t level = levelCount; level-- > 0;)
+  {
+    offset = (offset + 7) & ~static_cast<uint64_t>(7);
+    levelIndex[level] = {offset, texture.levels[level].size, texture.levels[level].size};
+    offset += texture.levels[level].size;
+  }
+
+  file.write(reinterpret_cast<const char *>(KTX2_IDENTIFIER), sizeof(KTX2_IDENTIFIER));
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(levelIndex.data()), levelIndex.size() * sizeof(Ktx2LevelIndex));
+  file.write(reinterpret_cast<const char *>(dfd.data()), dfd.size() * sizeof(uint32_t));
+
+  uint64_t written = header.dfdByteOffset + header.dfdByteLength;
+  const char padding[8] = {};
+  for (uint32_t level = levelCount; level-- > 0;)
+  {
+    file.write(padding, static_cast<std::streamsize>(levelIndex[level].byteOffset - written));
+    file.write(reinterpret_cast<const char *>(texture.bytes.data() + texture.levels[level].offset), static_cast<std::streamsize>(texture.levels[level].size));
+    written = levelIndex[level].byteOffset + texture.levels[level].size;
+  }
+  return static_cast<bool>(file);
+}
+
+void copyTextureLevels(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, const TextureData &texture)
+{
+  std::vector<VkBufferImageCopy> regions;
+  for (size_t level = 0; level < texture.levels.size(); level++)
+  {
+    VkBufferImageCopy region{};
+    region.bufferOffset = bufferOffset + texture.levels[level].offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = static_cast<uint32_t>(level);
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {texture.levels[level].width, texture.levels[level].height, 1};
+    regions.push_back(region);
+  }
+
+  vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+}
+
+void finishTextureLevels(VkCommandBuffer commandBuffer, VkImage image, const TextureData &texture, uint32_t mipLevels)
+{
+  if (texture.levels.size() >= mipLevels)
+  {
+    transitionImageLayout(commandBuffer, image, texture.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+    return;
+  }
+  generateMipmaps(commandBuffer, image, texture.width, texture.height, mipLevels);
+}
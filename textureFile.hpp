@@ -0,0 +1,47 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+// What textureBaker writes, sampled as sRGB like the PNGs it comes from
+#define COMPRESSED_TEXTURE_FORMAT VK_FORMAT_BC1_RGB_SRGB_BLOCK
+
+struct TextureLevel
+{
+  VkDeviceSize offset; // into TextureData::bytes, a multiple of the block size
+  VkDeviceSize size;
+  uint32_t width;
+  uint32_t height;
+};
+
+// Texel data ready to be copied into an image. A decoded PNG is a single RGBA8 level the uploader
+// blits mips from, a KTX2 file brings every level already block compressed.
+struct TextureData
+{
+  VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<TextureLevel> levels; // level 0 first
+  std::vector<unsigned char> bytes;
+
+  bool compressed() const { return format != VK_FORMAT_R8G8B8A8_SRGB; }
+  // levels the image gets, only uncompressed data can have the rest generated by blits
+  uint32_t imageMipLevels(bool generateMipmaps) const;
+  VkDeviceSize imageBytes(uint32_t mipLevels) const; // what the image holds once every level is filled
+};
+
+// textures/wood.png -> textures/wood.ktx2
+std::string compressedTexturePath(const std::string &path);
+
+// Uses the baked .ktx2 next to path when compressed is true and it is not older than path,
+// otherwise decodes path. False when neither could be read.
+bool loadTextureData(const std::string &path, bool compressed, TextureData &texture);
+bool readKtx2(const std::string &path, TextureData &texture);
+bool writeKtx2(const std::string &path, const TextureData &texture);
+
+// Copies every level in texture from a staging buffer holding texture.bytes at bufferOffset, the
+// image's levels must be in TRANSFER_DST_OPTIMAL
+void copyTextureLevels(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, const TextureData &texture);
+// Takes an image filled by copyTextureLevels to SHADER_READ_ONLY_OPTIMAL, blitting the levels the
+// data did not bring. Needs a graphics queue.
+void finishTextureLevels(VkCommandBuffer commandBuffer, VkImage image, const TextureData &texture, uint32_t mipLevels);
@@ -0,0 +1,267 @@
+#include "textureRegistry.hpp"
+#include "renderer.hpp"
+#include "utils.h"
+#include "textureFile.hpp"
+#include "descriptorManager.hpp"
+#include <cstring>
+#include <stdexcept>
+
+void TextureRegistry::init(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.anisotropyEnable = VK_TRUE;
+
+  VkPhysicalDeviceProperties properties{};
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+
+  samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  samplerInfo.unnormalizedCoordinates = VK_FALSE;
+  samplerInfo.compareEnable = VK_FALSE;
+  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.mipLodBias = 0.0f;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // each view's level count is the real limit
+  if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to create texture sampler!");
+  }
+
+  mipmaps = supportsLinearBlit(VK_FORMAT_R8G8B8A8_SRGB, physicalDevice);
+  compressedTextures = renderer.deviceManager.textureCompressionBC;
+}
+
+TextureHandle TextureRegistry::acquire(const std::string &path, VkDevice device)
+{
+  auto existing = handlesByPath.find(path);
+  if (existing != handlesByPath.end())
+  {
+    CachedTexture &texture = textures[existing->second];
+    texture.refCount++;
+    // still on its way through the uploader, load it now and let the async copy be dropped when it lands
+    if (!texture.ready)
+    {
+      upload(existing->second, device);
+    }
+    return existing->second;
+  }
+
+  TextureHandle handle = allocateHandle(path);
+  upload(handle, device);
+  return handle;
+}
+
+TextureHandle TextureRegistry::acquireAsync(const std::string &path)
+{
+  auto existing = handlesByPath.find(path);
+  if (existing != handlesByPath.end())
+  {
+    textures[existing->second].refCount++;
+    return existing->second;
+  }
+
+  TextureHandle handle = allocateHandle(path);
+  textures[handle].uploading = true;
+  renderer.textureUploader.request(handle, path);
+  return handle;
+}
+
+void TextureRegistry::release(TextureHandle handle, VkDevice device)
+{
+  if (handle < 0 || handle >= static_cast<TextureHandle>(textures.size()) || textures[handle].refCount == 0)
+  {
+    return;
+  }
+
+  CachedTexture &texture = textures[handle];
+  if (--texture.refCount > 0)
+  {
+    return;
+  }
+
+  handlesByPath.erase(texture.path);
+  retire(handle, device);
+}
+
+bool TextureRegistry::pollUploads(VkDevice device)
+{
+  bool changed = false;
+  for (TextureUpload &upload : renderer.textureUploader.poll(device))
+  {
+    completeUpload(upload, device);
+    changed = true;
+  }
+  return changed;
+}
+
+TextureMemoryStats TextureRegistry::stats() const
+{
+  TextureMemoryStats stats;
+  stats.arraySlots = textures.size();
+  for (const CachedTexture &texture : textures)
+  {
+    if (texture.refCount == 0)
+    {
+      continue;
+    }
+
+    size_t bytes = static_cast<size_t>(texture.bytes);
+    stats.textureCount++;
+    stats.compressedCount += texture.format != VK_FORMAT_R8G8B8A8_SRGB ? 1 : 0;
+    stats.references += texture.refCount;
+    stats.gpuBytes += bytes;
+    stats.unsharedGpuBytes += bytes * texture.refCount;
+  }
+  return stats;
+}
+
+void TextureRegistry::cleanup(VkDevice device)
+{
+  for (CachedTexture &texture : textures)
+  {
+    if (texture.image != VK_NULL_HANDLE)
+    {
+      vkDestroyImageView(device, texture.view, nullptr);
+      vkDestroyImage(device, texture.image, nullptr);
+      renderer.bufferManager.allocator.free(texture.allocation);
+    }
+  }
+  textures.clear();
+  freeHandles.clear(); // the texture set goes with its pool
+  handlesByPath.clear();
+
+  vkDestroySampler(device, sampler, nullptr);
+  sampler = VK_NULL_HANDLE;
+}
+
+TextureHandle TextureRegistry::allocateHandle(const std::string &path)
+{
+  TextureHandle handle;
+  if (!freeHandles.empty())
+  {
+    handle = freeHandles.back();
+    freeHandles.pop_back();
+  }
+  else
+  {
+    if (textures.size() >= MAX_BINDLESS_TEXTURES)
+    {
+      throw std::runtime_error("failed to allocate texture handle, the bindless texture array is full!");
+    }
+    handle = static_cast<TextureHandle>(textures.size());
+    textures.emplace_back();
+  }
+
+  CachedTexture &texture = textures[handle];
+  texture.path = path;
+  texture.refCount = 1;
+  handlesByPath[path] = handle;
+  return handle;
+}
+
+void TextureRegistry::upload(TextureHandle handle, VkDevice device)
+{
+  CachedTexture &texture = textures[handle];
+  TextureData data;
+  if (!loadTextureData(texture.path, compressedTextures, data))
+  {
+    throw std::runtime_error("failed to load texture image! Filepath: " + texture.path);
+  }
+
+  BufferManager &bufferManager = renderer.bufferManager;
+  StagingAllocation staging = bufferManager.uploadContext.stage(device, data.bytes.size());
+  memcpy(staging.data, data.bytes.data(), data.bytes.size());
+
+  texture.format = data.format;
+  texture.width = data.width;
+  texture.height = data.height;
+  texture.mipLevels = data.imageMipLevels(mipmaps);
+  texture.bytes = data.imageBytes(texture.mipLevels);
+
+  createImage(texture.width, texture.height, texture.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.image, texture.allocation, bufferManager.allocator, device, texture.mipLevels);
+
+  VkCommandBuffer commandBuffer = bufferManager.uploadContext.record(device);
+  transitionImageLayout(commandBuffer, texture.image, texture.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture.mipLevels);
+  copyTextureLevels(commandBuffer, staging.buffer, staging.offset, texture.image, data);
+  finishTextureLevels(commandBuffer, texture.image, data, texture.mipLevels);
+
+  texture.view = createImageView(texture.image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, device, texture.mipLevels);
+  renderer.descriptorManager.writeTexture(device, static_cast<uint32_t>(handle), texture.view, sampler);
+  texture.ready = true;
+  texture.failed = false;
+}
+
+void TextureRegistry::completeUpload(TextureUpload &upload, VkDevice device)
+{
+  CachedTexture &texture = textures[upload.key];
+  texture.uploading = false;
+
+  if (texture.refCount == 0 || texture.ready || upload.image == VK_NULL_HANDLE)
+  {
+    if (upload.image == VK_NULL_HANDLE && texture.refCount > 0 && !texture.ready)
+    {
+      texture.failed = true;
+    }
+
+    // the acquire barrier for it may still be waiting in the upload batch
+    AsyncTextureUploader &uploader = renderer.textureUploader;
+    renderer.destroyAfterFrames([device, upload, &uploader]() mutable
+                                { uploader.destroy(device, upload); });
+
+    // released while it was uploading, the slot was kept for this moment. A synchronous load may have
+    // filled its array element meanwhile, so it waits for the frames in flight like any other.
+    if (texture.refCount == 0)
+    {
+      texture = CachedTexture{};
+      TextureHandle handle = upload.key;
+      renderer.destroyAfterFrames([this, handle]()
+                                  { freeHandles.push_back(handle); });
+    }
+    return;
+  }
+
+  texture.image = upload.image;
+  texture.allocation = upload.allocation;
+  texture.view = upload.view;
+  texture.width = upload.width;
+  texture.height = upload.height;
+  texture.mipLevels = upload.mipLevels;
+  texture.format = upload.format;
+  texture.bytes = upload.bytes;
+  renderer.descriptorManager.writeTexture(device, static_cast<uint32_t>(upload.key), texture.view, sampler);
+  texture.ready = true;
+}
+
+void TextureRegistry::retire(TextureHandle handle, VkDevice device)
+{
+  CachedTexture &texture = textures[handle];
+  bool uploading = texture.uploading;
+  VkImage image = texture.image;
+  VkImageView view = texture.view;
+  GpuAllocation allocation = texture.allocation;
+  texture = CachedTexture{};
+  texture.uploading = uploading;
+
+  // frames already submitted may still sample it through its array element, which is only handed out
+  // again after them. An upload still carrying the handle frees it when it lands instead.
+  GpuAllocator &allocator = renderer.bufferManager.allocator;
+  renderer.destroyAfterFrames([this, handle, uploading, device, image, view, allocation, &allocator]() mutable
+                              {
+    if (image != VK_NULL_HANDLE)
+    {
+      vkDestroyImageView(device, view, nullptr);
+      vkDestroyImage(device, image, nullptr);
+      allocator.free(allocation);
+    }
+    if (!uploading)
+    {
+      freeHandles.push_back(handle);
+    } });
+}
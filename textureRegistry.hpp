@@ -0,0 +1,83 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "gpuAllocator.hpp"
+
+class Renderer;
+struct TextureUpload;
+
+using TextureHandle = int;
+const TextureHandle INVALID_TEXTURE = -1;
+
+struct CachedTexture
+{
+  std::string path;
+  VkImage image = VK_NULL_HANDLE;
+  GpuAllocation allocation;
+  VkImageView view = VK_NULL_HANDLE;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t mipLevels = 1;
+  VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+  VkDeviceSize bytes = 0; // every level
+  int refCount = 0;       // 0 marks a free slot
+  bool ready = false;     // false until the image is uploaded
+  bool failed = false;    // the file could not be decoded, ready never becomes true
+  bool uploading = false; // an async upload still carries this handle, the slot is not reused before it lands
+};
+
+struct TextureMemoryStats
+{
+  size_t textureCount = 0;
+  size_t compressedCount = 0; // loaded from a baked .ktx2
+  size_t references = 0;
+  size_t gpuBytes = 0;         // what the registry holds
+  size_t unsharedGpuBytes = 0; // what one copy per reference would take
+  size_t arraySlots = 0;       // bindless elements ever handed out, freed ones are reused before this grows
+};
+
+// Decodes and uploads every distinct texture file once and hands out refcounted handles to it. A
+// handle is also the texture's element in the bindless array, so changing what an object looks like
+// is a handle swap.
+class TextureRegistry
+{
+public:
+  TextureRegistry(Renderer &renderer) : renderer(renderer)
+  {
+  }
+
+  void init(VkDevice device, VkPhysicalDevice physicalDevice); // creates the sampler every texture shares, its LOD range covers any chain
+
+  // Returns the texture for path with one more reference, loading and uploading it on a miss. The
+  // baked .ktx2 is used when the device samples BC formats, the PNG is decoded otherwise. The
+  // upload is recorded into the UploadContext, so the texture is usable by the next frame.
+  TextureHandle acquire(const std::string &path, VkDevice device);
+  // Same, but a miss goes to the AsyncTextureUploader and the handle only becomes ready once it
+  // lands. Safe to call off the main thread as long as the caller holds the lock the frame holds.
+  TextureHandle acquireAsync(const std::string &path);
+  // Drops one reference, the last one retires the image and frees the array element once no frame in flight uses them
+  void release(TextureHandle handle, VkDevice device);
+  const CachedTexture &get(TextureHandle handle) const { return textures[handle]; }
+
+  // Main thread, once per frame: takes what the uploader finished, true if any handle became ready or failed
+  bool pollUploads(VkDevice device);
+
+  TextureMemoryStats stats() const;
+  void cleanup(VkDevice device); // device idle, after the uploader and before the allocator
+
+private:
+  Renderer &renderer;
+  VkSampler sampler = VK_NULL_HANDLE;
+  bool mipmaps = false;            // RGBA8 can be blitted with linear filtering
+  bool compressedTextures = false; // BC formats can be sampled
+  std::vector<CachedTexture> textures;
+  std::vector<TextureHandle> freeHandles;
+  std::unordered_map<std::string, TextureHandle> handlesByPath;
+
+  TextureHandle allocateHandle(const std::string &path);
+  void upload(TextureHandle handle, VkDevice device);
+  void completeUpload(TextureUpload &upload, VkDevice device);
+  void retire(TextureHandle handle, VkDevice device);
+};
@@ -0,0 +1,28 @@
+#include "triggerSystem.hpp"
+
+btBroadphasePair *TriggerSystem::addOverlappingPair(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1)
+{
+  queueEvents(proxy0, proxy1, true);
+  return btGhostPairCallback::addOverlappingPair(proxy0, proxy1);
+}
+
+void *TriggerSystem::removeOverlappingPair(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1, btDispatcher *dispatcher)
+{
+  queueEvents(proxy0, proxy1, false);
+  return btGhostPairCallback::removeOverlappingPair(proxy0, proxy1, dispatcher);
+}
+
+void TriggerSystem::queueEvents(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1, bool entered)
+{
+  btCollisionObject *object0 = static_cast<btCollisionObject *>(proxy0->m_clientObject);
+  btCollisionObject *object1 = static_cast<btCollisionObject *>(proxy1->m_clientObject);
+
+  if (btGhostObject::upcast(object0))
+  {
+    events.push_back({object0->getUserIndex(), object1->getUserIndex(), entered});
+  }
+  if (btGhostObject::upcast(object1))
+  {
+    events.push_back({object1->getUserIndex(), object0->getUserIndex(), entered});
+  }
+}
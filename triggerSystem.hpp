@@ -0,0 +1,27 @@
+#pragma once
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+#include <vector>
+
+// Objects are identified by their collision object's user index (the GameObject id), so queued
+// events stay valid even if an object is removed before they are processed.
+struct TriggerEvent
+{
+  int triggerIndex;
+  int otherIndex;
+  bool entered;
+};
+
+// Installed as the broadphase ghost pair callback. Overlaps that involve a btGhostObject are queued as
+// enter/exit events as the broadphase finds them, so gameplay never has to scan for overlaps.
+class TriggerSystem : public btGhostPairCallback
+{
+public:
+  std::vector<TriggerEvent> events;
+
+  btBroadphasePair *addOverlappingPair(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1) override;
+  void *removeOverlappingPair(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1, btDispatcher *dispatcher) override;
+
+private:
+  void queueEvents(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1, bool entered);
+};
@@ -0,0 +1,163 @@
+#include "uploadContext.hpp"
+#include <stdexcept>
+
+void UploadContext::init(VkDevice device, VkCommandPool commandPool, VkQueue queue, StagingRing &stagingRing)
+{
+  this->commandPool = commandPool;
+  this->queue = queue;
+  this->stagingRing = &stagingRing;
+}
+
+void UploadContext::cleanup(VkDevice device)
+{
+  if (stagingRing == nullptr)
+  {
+    return;
+  }
+
+  wait(device, flush(device));
+  recycle(device);
+  if (!freeCommandBuffers.empty())
+  {
+    vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(freeCommandBuffers.size()), freeCommandBuffers.data());
+  }
+  freeCommandBuffers.clear();
+  stagingRing = nullptr;
+}
+
+StagingAllocation UploadContext::stage(VkDevice device, VkDeviceSize size, VkDeviceSize alignment)
+{
+  // keeping the batch under half the ring means the new allocation always has a contiguous range
+  // left, so the ring never has to wait on space that only this unsubmitted batch holds
+  VkDeviceSize unclaimed = stagingRing->unclaimedBytes();
+  if (unclaimed > 0 && (unclaimed + size + alignment) * 2 > stagingRing->capacity())
+  {
+    flush(device);
+  }
+
+  record(device);
+  return stagingRing->allocate(device, size, alignment);
+}
+
+VkCommandBuffer UploadContext::record(VkDevice device)
+{
+  if (recording != VK_NULL_HANDLE)
+  {
+    return recording;
+  }
+
+  recycle(device);
+  if (!freeCommandBuffers.empty())
+  {
+    recording = freeCommandBuffers.back();
+    freeCommandBuffers.pop_back();
+  }
+  else
+  {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, &recording) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  if (vkBeginCommandBuffer(recording, &beginInfo) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to begin recording upload command buffer!");
+  }
+  return recording;
+}
+
+void UploadContext::waitTimeline(VkDevice device, VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage)
+{
+  record(device);
+  waitSemaphores.push_back(semaphore);
+  waitValues.push_back(value);
+  waitStages.push_back(stage);
+}
+
+UploadToken UploadContext::flush(VkDevice device)
+{
+  if (recording == VK_NULL_HANDLE)
+  {
+    return stagingRing->claimedCount();
+  }
+
+  // later submissions on this queue read what the batch wrote as vertices, indices or from shaders
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(recording, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  if (vkEndCommandBuffer(recording) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to record upload command buffer!");
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &recording;
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  if (!waitSemaphores.empty())
+  {
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+  }
+
+  // the ring's fence also tells it when the batch's staging space can be reused
+  VkFence fence = stagingRing->claimFence(device);
+  if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS)
+  {
+    throw std::runtime_error("failed to submit upload batch!");
+  }
+
+  waitSemaphores.clear();
+  waitValues.clear();
+  waitStages.clear();
+
+  UploadToken token = stagingRing->claimedCount();
+  inFlight.push_back({token, recording});
+  recording = VK_NULL_HANDLE;
+  submits++;
+  return token;
+}
+
+bool UploadContext::isComplete(VkDevice device, UploadToken token)
+{
+  return stagingRing->isRetired(device, token);
+}
+
+void UploadContext::wait(VkDevice device, UploadToken token)
+{
+  if (token > stagingRing->claimedCount())
+  {
+    flush(device);
+  }
+  stagingRing->waitRetired(device, token);
+}
+
+void UploadContext::recycle(VkDevice device)
+{
+  while (!inFlight.empty() && stagingRing->isRetired(device, inFlight.front().token))
+  {
+    freeCommandBuffers.push_back(inFlight.front().commandBuffer);
+    inFlight.pop_front();
+  }
+}
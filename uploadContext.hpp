@@ -0,0 +1,56 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <vector>
+#include "stagingRing.hpp"
+
+// Completes once every upload recorded before it was handed out has executed
+using UploadToken = uint64_t;
+
+// Records copies and layout transitions from many uploads into one command buffer and submits them
+// together, instead of one submit and queue stall per copy. A batch is submitted on flush(), when
+// its staging space runs low, or by the renderer right before the next frame so draws see it.
+class UploadContext
+{
+public:
+  void init(VkDevice device, VkCommandPool commandPool, VkQueue queue, StagingRing &stagingRing);
+  void cleanup(VkDevice device);
+
+  // Staging space for the current batch, flushes it first if the ring could not fit both
+  StagingAllocation stage(VkDevice device, VkDeviceSize size, VkDeviceSize alignment = 16);
+  // Command buffer of the current batch, begun on first use
+  VkCommandBuffer record(VkDevice device);
+  // Makes the current batch wait for a timeline semaphore value, e.g. before acquiring an image
+  // another queue released
+  void waitTimeline(VkDevice device, VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage);
+  // Token of the batch being recorded, valid once it is flushed
+  UploadToken pendingToken() const { return stagingRing->claimedCount() + 1; }
+
+  // Submits the current batch, returns the last batch's token when nothing was recorded
+  UploadToken flush(VkDevice device);
+  bool isComplete(VkDevice device, UploadToken token);
+  void wait(VkDevice device, UploadToken token);
+
+  bool hasPending() const { return recording != VK_NULL_HANDLE; }
+  size_t submitCount() const { return submits; }
+
+private:
+  struct Batch
+  {
+    UploadToken token;
+    VkCommandBuffer commandBuffer;
+  };
+
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  VkQueue queue = VK_NULL_HANDLE;
+  StagingRing *stagingRing = nullptr;
+  VkCommandBuffer recording = VK_NULL_HANDLE;
+  std::deque<Batch> inFlight;
+  std::vector<VkCommandBuffer> freeCommandBuffers;
+  std::vector<VkSemaphore> waitSemaphores;
+  std::vector<uint64_t> waitValues;
+  std::vector<VkPipelineStageFlags> waitStages;
+  size_t submits = 0;
+
+  void recycle(VkDevice device);
+};
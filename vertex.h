@@ -45,4 +45,41 @@ struct Vertex
   }
 };
 
+// Per-instance data, read from vertex binding 1 which steps once per instance
+struct InstanceData
+{
+  glm::mat4 model;
+  uint32_t textureIndex; // the TextureHandle, its element in the bindless texture array
+
+  static VkVertexInputBindingDescription getBindingDescription()
+  {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 1;
+    bindingDescription.stride = sizeof(InstanceData);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    return bindingDescription;
+  }
+
+  // a mat4 attribute takes four consecutive locations, one per column
+  static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions()
+  {
+    std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+    for (uint32_t column = 0; column < 4; column++)
+    {
+      attributeDescriptions[column].binding = 1;
+      attributeDescriptions[column].location = 3 + column;
+      attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+      attributeDescriptions[column].offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+    }
+
+    attributeDescriptions[4].binding = 1;
+    attributeDescriptions[4].location = 7;
+    attributeDescriptions[4].format = VK_FORMAT_R32_UINT;
+    attributeDescriptions[4].offset = offsetof(InstanceData, textureIndex);
+
+    return attributeDescriptions;
+  }
+};
+
 #endif
\ No newline at end of file